@@ -122,6 +122,39 @@ qboolean SCR_ParseColor(const char *s, color_t *color);
 
 float V_CalcFov(float fov_x, float width, float height);
 
+// CPU profiling scopes, shared with the renderer
+#define CL_PROF_LIST \
+    CL_PROF_DO(CL_PROF_FRAME,       "frame") \
+    CL_PROF_DO(CL_PROF_PARSE,       "parse") \
+    CL_PROF_DO(CL_PROF_PREDICT,     "predict") \
+    CL_PROF_DO(CL_PROF_SCREEN,      "screen") \
+    CL_PROF_DO(CL_PROF_WAIT,        "wait") \
+    CL_PROF_DO(CL_PROF_ENTITIES,    "entities") \
+    CL_PROF_DO(CL_PROF_TRANSFORMS,  "transforms") \
+    CL_PROF_DO(CL_PROF_UNIFORMS,    "uniforms") \
+    CL_PROF_DO(CL_PROF_RECORD,      "record") \
+    CL_PROF_DO(CL_PROF_SUBMIT,      "submit") \
+    CL_PROF_DO(CL_PROF_SOUND,       "sound")
+
+typedef enum {
+#define CL_PROF_DO(id, name) id,
+    CL_PROF_LIST
+#undef CL_PROF_DO
+    CL_PROF_NUM_SCOPES
+} clprof_t;
+
+extern qboolean cl_prof_active;
+
+#define CL_PROF_START(s)    (cl_prof_active ? CL_ProfStart(s) : (void)0)
+#define CL_PROF_STOP(s)     (cl_prof_active ? CL_ProfStop(s) : (void)0)
+
+void CL_ProfStart(clprof_t scope);
+void CL_ProfStop(clprof_t scope);
+unsigned CL_ProfFrame(void);
+float CL_ProfLastMsec(clprof_t scope);
+const char *CL_ProfName(clprof_t scope);
+void CL_ProfGpuEvent(unsigned frame, const char *name, uint64_t start, unsigned dur);
+
 #else // USE_CLIENT
 
 #define CL_Init()                       (void)0
@@ -42,6 +42,11 @@ void S_EndRegistration(void);
 void S_RawSamples(int samples, int rate, int width,
 		int channels, byte *data, float volume);
 
+#if USE_SNDDMA
+// time single pass looped sound summing against the per-type rescan
+int S_TestLoopSounds(int count, int types, int frames, unsigned *msec, unsigned *ref_msec);
+#endif
+
 extern  vec3_t  listener_origin;
 extern  vec3_t  listener_forward;
 extern  vec3_t  listener_right;
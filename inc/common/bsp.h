@@ -32,10 +32,6 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 // maximum size of a PVS row, in bytes
 #define VIS_MAX_BYTES   (MAX_MAP_LEAFS >> 3)
 
-// take advantage of 64-bit systems
-#define VIS_FAST_LONGS(bsp) \
-    (((bsp)->visrowsize + sizeof(uint_fast32_t) - 1) / sizeof(uint_fast32_t))
-
 typedef struct mtexinfo_s {  // used internally due to name len probs //ZOID
     csurface_t          c;
     char                name[MAX_TEXNAME];
@@ -282,6 +278,8 @@ typedef struct bsp_s {
 
 qerror_t BSP_Load(const char *name, bsp_t **bsp_p);
 void BSP_Free(bsp_t *bsp);
+qerror_t BSP_Preload(const char *name);
+void BSP_PollPreload(void);
 const char *BSP_GetError(void);
 
 #if USE_REF
@@ -298,6 +296,10 @@ void BSP_TransformedLightPoint(lightpoint_t *point, vec3_t start, vec3_t end,
 #endif
 
 byte *BSP_ClusterVis(bsp_t *bsp, byte *mask, int cluster, int vis);
+void BSP_VisOr(byte *dst, const byte *src, int size);
+void BSP_VisAnd(byte *dst, const byte *src, int size);
+int BSP_VisCount(const byte *row, int size);
+int BSP_VisBits(const byte *row, int size, int *bits);
 mleaf_t *BSP_PointLeaf(mnode_t *node, vec3_t p);
 mmodel_t *BSP_InlineModel(bsp_t *bsp, const char *name);
 
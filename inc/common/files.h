@@ -68,11 +68,12 @@ typedef struct file_info_s {
 #define FS_SEARCH_DIRSONLY      0x00001000
 #define FS_SEARCH_MASK          0x00001f00
 
-// bits 8 - 11, flag
+// bits 8 - 12, flag
 #define FS_FLAG_GZIP            0x00000100
 #define FS_FLAG_EXCL            0x00000200
 #define FS_FLAG_TEXT            0x00000400
 #define FS_FLAG_DEFLATE         0x00000800
+#define FS_FLAG_ASYNC           0x00001000
 
 //
 // Limit the maximum file size FS_LoadFile can handle, as a protection from
@@ -111,6 +112,14 @@ qerror_t FS_RenameFile(const char *from, const char *to);
 
 qerror_t FS_CreatePath(char *path);
 
+void    FS_InvalidatePath(const char *path);
+void    FS_BeginRegistration(void);
+void    FS_EndRegistration(void);
+void    FS_AbortRegistration(void);
+void    FS_PrefetchFile(const char *name);
+void    FS_StartPrefetch(void);
+void    FS_StopPrefetch(void);
+
 char    *FS_CopyExtraInfo(const char *name, const file_info_t *info);
 
 ssize_t FS_FOpenFile(const char *filename, qhandle_t *f, unsigned mode);
@@ -136,6 +145,10 @@ ssize_t FS_LoadFileEx(const char *path, void **buffer, unsigned flags, memtag_t
 // a NULL buffer will just return the file length without loading
 // length < 0 indicates error
 
+// mapped or loaded read-only, release with FS_UnmapFile
+ssize_t FS_MapFile(const char *path, const void **buffer, void **handle);
+void    FS_UnmapFile(void *handle);
+
 qerror_t FS_WriteFile(const char *path, const void *data, size_t len);
 
 qboolean FS_EasyWriteFile(char *buf, size_t size, unsigned mode,
@@ -155,6 +168,7 @@ ssize_t FS_Tell(qhandle_t f);
 qerror_t FS_Seek(qhandle_t f, off_t offset);
 
 ssize_t  FS_Length(qhandle_t f);
+qerror_t FS_GetFileInfo(qhandle_t f, file_info_t *info);
 
 qboolean FS_WildCmp(const char *filter, const char *string);
 qboolean FS_ExtCmp(const char *extension, const char *string);
@@ -0,0 +1,29 @@
+/*
+Copyright (C) 2003-2012 Andrey Nazarov
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// Chrome trace event format writer, see trace.c
+void Com_TraceBegin(qhandle_t f, int tid, const char *thread);
+void Com_TraceThread(qhandle_t f, int tid, const char *thread);
+void Com_TraceEvent(qhandle_t f, const char *name, int tid,
+                    unsigned ts, unsigned dur, unsigned frame);
+ssize_t Com_TraceEnd(qhandle_t f);
+
+#endif // TRACE_H
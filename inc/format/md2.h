@@ -38,7 +38,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define MD2_MAX_SKINWIDTH   640
 #define MD2_MAX_SKINHEIGHT  480
 
-typedef struct {
+typedef struct dmd2stvert_s {
     int16_t    s;
     int16_t    t;
 } dmd2stvert_t;
@@ -86,7 +86,11 @@ model_t *MOD_ForHandle(qhandle_t h);
 qhandle_t R_RegisterModel(const char *name);
 
 struct dmd2header_s;
+struct dmd2stvert_s;
 qerror_t MOD_ValidateMD2(struct dmd2header_s *header, size_t length);
+int MOD_WeldMD2(const uint16_t *vertIndices, const uint16_t *tcIndices,
+                const struct dmd2stvert_s *src_tc, int numindices,
+                uint16_t *remap, uint16_t *finalIndices);
 
 // these are implemented in [gl,sw]_models.c
 typedef qerror_t (*mod_load_t)(model_t *, const void *, size_t);
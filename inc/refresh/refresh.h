@@ -250,6 +250,13 @@ void    R_ModeChanged(int width, int height, int flags, int rowbytes, void *pixe
 // add decal to ring buffer
 void    R_AddDecal(decal_t *d);
 
+#if REF_VKPT
+// write baked world data for a map without loading textures
+qerror_t R_BakeMap(const char *name);
+// check welded world mesh against unshared triangles
+qerror_t R_TestMapMesh(const char *name, int *num_vertices, int *num_indices);
+#endif
+
 #ifdef _GL_DEBUG
 void    R_SetRayProbe(vec3_t p, vec3_t n);
 #endif
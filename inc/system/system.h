@@ -27,6 +27,7 @@ void    Sys_FreeLibrary(void *handle);
 void    *Sys_GetProcAddress(void *handle, const char *sym);
 
 unsigned    Sys_Milliseconds(void);
+uint64_t    Sys_Microseconds(void);     // monotonic, for profiling
 void    Sys_Sleep(int msec);
 
 void    Sys_Init(void);
@@ -54,6 +55,24 @@ void    Sys_ListFiles_r(const char *path, const char *filter,
 
 void    Sys_DebugBreak(void);
 
+// threads and synchronization primitives. handles are created and destroyed
+// by the main thread only. condition variables support one waiter at a time
+// and are signaled sticky, callers must recheck their predicate in a loop.
+void    *Sys_CreateThread(void (*func)(void *), void *arg);
+void    Sys_JoinThread(void *thread);
+void    *Sys_CreateMutex(void);
+void    Sys_DestroyMutex(void *mutex);
+void    Sys_LockMutex(void *mutex);
+void    Sys_UnlockMutex(void *mutex);
+void    *Sys_CreateCond(void);
+void    Sys_DestroyCond(void *cond);
+void    Sys_WaitCond(void *cond, void *mutex);
+void    Sys_SignalCond(void *cond);
+
+// read-only file mapping, returns NULL if not supported for this file
+void    *Sys_MapFile(FILE *fp, size_t offset, size_t len, const void **data);
+void    Sys_UnmapFile(void *map);
+
 #if USE_AC_CLIENT
 qboolean Sys_GetAntiCheatAPI(void);
 #endif
@@ -514,11 +514,16 @@ T_RadiusDamage
 void T_RadiusDamage(edict_t *inflictor, edict_t *attacker, float damage, edict_t *ignore, float radius, int mod)
 {
     float   points;
-    edict_t *ent = NULL;
+    edict_t *touch[MAX_EDICTS], *ent;
+    int     i, num;
     vec3_t  v;
     vec3_t  dir;
 
-    while ((ent = findradius(ent, inflictor->s.origin, radius)) != NULL) {
+    num = G_FindRadius(inflictor->s.origin, radius, touch, MAX_EDICTS);
+    for (i = 0 ; i < num ; i++) {
+        ent = touch[i];
+        if (!G_InRadius(ent, inflictor->s.origin, radius))
+            continue;
         if (ent == ignore)
             continue;
         if (!ent->takedamage)
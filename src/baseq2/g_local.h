@@ -611,7 +611,10 @@ void Touch_Item(edict_t *ent, edict_t *other, cplane_t *plane, csurface_t *surf)
 qboolean    KillBox(edict_t *ent);
 void    G_ProjectSource(const vec3_t point, const vec3_t distance, const vec3_t forward, const vec3_t right, vec3_t result);
 edict_t *G_Find(edict_t *from, int fieldofs, char *match);
+edict_t *G_FindLinear(edict_t *from, int fieldofs, char *match);
 edict_t *findradius(edict_t *from, vec3_t org, float rad);
+qboolean G_InRadius(edict_t *ent, vec3_t org, float rad);
+int     G_FindRadius(vec3_t org, float rad, edict_t **list, int maxcount);
 edict_t *G_PickTarget(char *targetname);
 void    G_UseTargets(edict_t *ent, edict_t *activator);
 void    G_SetMovedir(vec3_t angles, vec3_t movedir);
@@ -620,6 +623,12 @@ void    G_InitEdict(edict_t *e);
 edict_t *G_Spawn(void);
 void    G_FreeEdict(edict_t *e);
 
+void    G_InitFindIndex(void);
+void    G_ClearFindIndex(void);
+void    G_IndexEdict(edict_t *ent);
+void    G_SetClassname(edict_t *ent, char *classname);
+void    G_SetTargetname(edict_t *ent, char *targetname);
+
 void    G_TouchTriggers(edict_t *ent);
 void    G_TouchSolids(edict_t *ent);
 
@@ -781,6 +790,7 @@ void M_ChangeYaw(edict_t *ent);
 //
 // g_phys.c
 //
+qboolean G_EntityIdle(edict_t *ent);
 void G_RunEntity(edict_t *ent);
 
 //
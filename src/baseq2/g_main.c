@@ -180,6 +180,7 @@ void InitGame(void)
     g_edicts = gi.TagMalloc(game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
     globals.edicts = g_edicts;
     globals.max_edicts = game.maxentities;
+    G_InitFindIndex();
 
     // initialize all clients for this game
     game.maxclients = maxclients->value;
@@ -293,7 +294,7 @@ edict_t *CreateTargetChangeLevel(char *map)
     edict_t *ent;
 
     ent = G_Spawn();
-    ent->classname = "target_changelevel";
+    G_SetClassname(ent, "target_changelevel");
     Q_snprintf(level.nextmap, sizeof(level.nextmap), "%s", map);
     ent->map = level.nextmap;
     return ent;
@@ -504,6 +505,10 @@ void G_RunFrame(void)
             continue;
         }
 
+        // most entities are idle most of the time
+        if (G_EntityIdle(ent))
+            continue;
+
         G_RunEntity(ent);
     }
 
@@ -89,14 +89,22 @@ SV_RunThink
 Runs thinking code for this frame if necessary
 =============
 */
-qboolean SV_RunThink(edict_t *ent)
+static qboolean SV_ThinkDue(edict_t *ent)
 {
     float   thinktime;
 
     thinktime = ent->nextthink;
     if (thinktime <= 0)
-        return qtrue;
+        return qfalse;
     if (thinktime > level.time + 0.001)
+        return qfalse;
+
+    return qtrue;
+}
+
+qboolean SV_RunThink(edict_t *ent)
+{
+    if (!SV_ThinkDue(ent))
         return qtrue;
 
     ent->nextthink = 0;
@@ -896,6 +904,56 @@ void SV_Physics_Step(edict_t *ent)
 }
 
 //============================================================================
+/*
+================
+G_EntityIdle
+
+Returns true if G_RunEntity would do nothing for this entity this frame:
+it has no prethink, no think is due, and it isn't going to move. Checks
+mirror early exits of the physics functions.
+================
+*/
+qboolean G_EntityIdle(edict_t *ent)
+{
+    edict_t *part;
+
+    if (ent->prethink)
+        return qfalse;
+
+    switch ((int)ent->movetype) {
+    case MOVETYPE_PUSH:
+    case MOVETYPE_STOP:
+        if (ent->flags & FL_TEAMSLAVE)
+            return qtrue;
+        for (part = ent ; part ; part = part->teamchain) {
+            if (SV_ThinkDue(part))
+                return qfalse;
+            if (part->velocity[0] || part->velocity[1] || part->velocity[2] ||
+                part->avelocity[0] || part->avelocity[1] || part->avelocity[2])
+                return qfalse;
+        }
+        return qtrue;
+    case MOVETYPE_NONE:
+        return !SV_ThinkDue(ent);
+    case MOVETYPE_TOSS:
+    case MOVETYPE_BOUNCE:
+    case MOVETYPE_FLY:
+    case MOVETYPE_FLYMISSILE:
+        // resting on the ground
+        if (SV_ThinkDue(ent))
+            return qfalse;
+        if (ent->flags & FL_TEAMSLAVE)
+            return qtrue;
+        if (ent->velocity[2] > 0)
+            return qfalse;
+        if (!ent->groundentity || !ent->groundentity->inuse)
+            return qfalse;
+        return qtrue;
+    default:
+        return qfalse;
+    }
+}
+
 /*
 ================
 G_RunEntity
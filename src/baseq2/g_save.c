@@ -430,58 +430,201 @@ static const save_field_t gamefields[] = {
 
 //=========================================================
 
-static void write_data(void *buf, size_t len, FILE *f)
+/*
+Savegames are serialized into a memory buffer in one pass and then
+written out with a single call. Loading reads the whole file into
+memory and deserializes from there.
+*/
+typedef struct {
+    byte    *data;
+    size_t  maxsize;
+    size_t  cursize;
+    size_t  readcount;
+} savebuf_t;
+
+#define SAVEBUF_MINSIZE     0x10000
+
+static void savebuf_grow(savebuf_t *b, size_t len)
+{
+    size_t  newsize;
+    byte    *data;
+
+    newsize = max(b->maxsize, SAVEBUF_MINSIZE);
+    while (newsize - b->cursize < len) {
+        if (newsize > SIZE_MAX / 2)
+            gi.error("%s: overflow", __func__);
+        newsize *= 2;
+    }
+
+    data = gi.TagMalloc(newsize, TAG_GAME);
+    if (b->data) {
+        memcpy(data, b->data, b->cursize);
+        gi.TagFree(b->data);
+    }
+    b->data = data;
+    b->maxsize = newsize;
+}
+
+static void savebuf_free(savebuf_t *b)
+{
+    if (b->data)
+        gi.TagFree(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+static void savebuf_writefile(savebuf_t *b, const char *filename)
+{
+    FILE    *f;
+    size_t  len;
+
+    f = fopen(filename, "wb");
+    if (!f)
+        gi.error("Couldn't open %s", filename);
+
+    len = fwrite(b->data, 1, b->cursize, f);
+    if (fclose(f) || len != b->cursize)
+        gi.error("%s: couldn't write %"PRIz" bytes", __func__, b->cursize);
+}
+
+static void savebuf_readfile(savebuf_t *b, const char *filename)
+{
+    FILE    *f;
+    long    len;
+
+    f = fopen(filename, "rb");
+    if (!f)
+        gi.error("Couldn't open %s", filename);
+
+    if (fseek(f, 0, SEEK_END) || (len = ftell(f)) < 0 || fseek(f, 0, SEEK_SET)) {
+        fclose(f);
+        gi.error("Couldn't seek %s", filename);
+    }
+
+    memset(b, 0, sizeof(*b));
+    b->data = gi.TagMalloc(len + 1, TAG_GAME);
+    b->maxsize = len;
+
+    if (fread(b->data, 1, len, f) != (size_t)len) {
+        fclose(f);
+        gi.error("%s: couldn't read %ld bytes", __func__, len);
+    }
+    b->cursize = len;
+
+    fclose(f);
+}
+
+/*
+Pointer to save_ptrs[] index translation goes through a hash table built
+on first use, since the table holds several hundred entries.
+*/
+#define PTR_HASH_SIZE   4096
+
+static int      ptr_hash[PTR_HASH_SIZE];    // save_ptrs index + 1, 0 is empty
+static qboolean ptr_hash_ready;
+
+static unsigned ptr_hashval(void *p, ptr_type_t type)
+{
+    uintptr_t v = (uintptr_t)p;
+
+    v ^= v >> 16;
+    v *= 0x45d9f3b;
+    v ^= v >> 16;
+    return (unsigned)(v + type * 0x9e3779b1) & (PTR_HASH_SIZE - 1);
+}
+
+static void init_ptr_hash(void)
+{
+    const save_ptr_t *ptr;
+    unsigned hash;
+    int i;
+
+    if (num_save_ptrs > PTR_HASH_SIZE / 2)
+        gi.error("%s: too many pointers", __func__);
+
+    for (i = 0, ptr = save_ptrs; i < num_save_ptrs; i++, ptr++) {
+        hash = ptr_hashval(ptr->ptr, ptr->type);
+        while (ptr_hash[hash])
+            hash = (hash + 1) & (PTR_HASH_SIZE - 1);
+        ptr_hash[hash] = i + 1;
+    }
+
+    ptr_hash_ready = qtrue;
+}
+
+static int find_ptr(void *p, ptr_type_t type)
 {
-    if (fwrite(buf, 1, len, f) != len) {
-        gi.error("%s: couldn't write %"PRIz" bytes", __func__, len);
+    const save_ptr_t *ptr;
+    unsigned hash;
+    int index;
+
+    if (!ptr_hash_ready)
+        init_ptr_hash();
+
+    hash = ptr_hashval(p, type);
+    while ((index = ptr_hash[hash]) != 0) {
+        ptr = &save_ptrs[index - 1];
+        if (ptr->type == type && ptr->ptr == p)
+            return index - 1;
+        hash = (hash + 1) & (PTR_HASH_SIZE - 1);
     }
+
+    return -1;
+}
+
+static void write_data(savebuf_t *b, const void *buf, size_t len)
+{
+    if (b->maxsize - b->cursize < len)
+        savebuf_grow(b, len);
+
+    memcpy(b->data + b->cursize, buf, len);
+    b->cursize += len;
 }
 
-static void write_short(FILE *f, short v)
+static void write_short(savebuf_t *b, short v)
 {
     v = LittleShort(v);
-    write_data(&v, sizeof(v), f);
+    write_data(b, &v, sizeof(v));
 }
 
-static void write_int(FILE *f, int v)
+static void write_int(savebuf_t *b, int v)
 {
     v = LittleLong(v);
-    write_data(&v, sizeof(v), f);
+    write_data(b, &v, sizeof(v));
 }
 
-static void write_float(FILE *f, float v)
+static void write_float(savebuf_t *b, float v)
 {
     v = LittleFloat(v);
-    write_data(&v, sizeof(v), f);
+    write_data(b, &v, sizeof(v));
 }
 
-static void write_string(FILE *f, char *s)
+static void write_string(savebuf_t *b, char *s)
 {
     size_t len;
 
     if (!s) {
-        write_int(f, -1);
+        write_int(b, -1);
         return;
     }
 
     len = strlen(s);
-    write_int(f, len);
-    write_data(s, len, f);
+    write_int(b, len);
+    write_data(b, s, len);
 }
 
-static void write_vector(FILE *f, vec_t *v)
+static void write_vector(savebuf_t *b, vec_t *v)
 {
-    write_float(f, v[0]);
-    write_float(f, v[1]);
-    write_float(f, v[2]);
+    write_float(b, v[0]);
+    write_float(b, v[1]);
+    write_float(b, v[2]);
 }
 
-static void write_index(FILE *f, void *p, size_t size, void *start, int max_index)
+static void write_index(savebuf_t *b, void *p, size_t size, void *start, int max_index)
 {
     size_t diff;
 
     if (!p) {
-        write_int(f, -1);
+        write_int(b, -1);
         return;
     }
 
@@ -493,76 +636,73 @@ static void write_index(FILE *f, void *p, size_t size, void *start, int max_inde
     if (diff % size) {
         gi.error("%s: misaligned pointer: %p", __func__, p);
     }
-    write_int(f, (int)(diff / size));
+    write_int(b, (int)(diff / size));
 }
 
-static void write_pointer(FILE *f, void *p, ptr_type_t type)
+static void write_pointer(savebuf_t *b, void *p, ptr_type_t type)
 {
-    const save_ptr_t *ptr;
-    int i;
+    int index;
 
     if (!p) {
-        write_int(f, -1);
+        write_int(b, -1);
         return;
     }
 
-    for (i = 0, ptr = save_ptrs; i < num_save_ptrs; i++, ptr++) {
-        if (ptr->type == type && ptr->ptr == p) {
-            write_int(f, i);
-            return;
-        }
+    index = find_ptr(p, type);
+    if (index == -1) {
+        gi.error("%s: unknown pointer: %p", __func__, p);
     }
 
-    gi.error("%s: unknown pointer: %p", __func__, p);
+    write_int(b, index);
 }
 
-static void write_field(FILE *f, const save_field_t *field, void *base)
+static void write_field(savebuf_t *b, const save_field_t *field, void *base)
 {
     void *p = (byte *)base + field->ofs;
     int i;
 
     switch (field->type) {
     case F_BYTE:
-        write_data(p, field->size, f);
+        write_data(b, p, field->size);
         break;
     case F_SHORT:
         for (i = 0; i < field->size; i++) {
-            write_short(f, ((short *)p)[i]);
+            write_short(b, ((short *)p)[i]);
         }
         break;
     case F_INT:
         for (i = 0; i < field->size; i++) {
-            write_int(f, ((int *)p)[i]);
+            write_int(b, ((int *)p)[i]);
         }
         break;
     case F_FLOAT:
         for (i = 0; i < field->size; i++) {
-            write_float(f, ((float *)p)[i]);
+            write_float(b, ((float *)p)[i]);
         }
         break;
     case F_VECTOR:
-        write_vector(f, (vec_t *)p);
+        write_vector(b, (vec_t *)p);
         break;
 
     case F_ZSTRING:
-        write_string(f, (char *)p);
+        write_string(b, (char *)p);
         break;
     case F_LSTRING:
-        write_string(f, *(char **)p);
+        write_string(b, *(char **)p);
         break;
 
     case F_EDICT:
-        write_index(f, *(void **)p, sizeof(edict_t), g_edicts, MAX_EDICTS - 1);
+        write_index(b, *(void **)p, sizeof(edict_t), g_edicts, MAX_EDICTS - 1);
         break;
     case F_CLIENT:
-        write_index(f, *(void **)p, sizeof(gclient_t), game.clients, game.maxclients - 1);
+        write_index(b, *(void **)p, sizeof(gclient_t), game.clients, game.maxclients - 1);
         break;
     case F_ITEM:
-        write_index(f, *(void **)p, sizeof(gitem_t), itemlist, game.num_items - 1);
+        write_index(b, *(void **)p, sizeof(gitem_t), itemlist, game.num_items - 1);
         break;
 
     case F_POINTER:
-        write_pointer(f, *(void **)p, field->size);
+        write_pointer(b, *(void **)p, field->size);
         break;
 
     default:
@@ -570,59 +710,62 @@ static void write_field(FILE *f, const save_field_t *field, void *base)
     }
 }
 
-static void write_fields(FILE *f, const save_field_t *fields, void *base)
+static void write_fields(savebuf_t *b, const save_field_t *fields, void *base)
 {
     const save_field_t *field;
 
     for (field = fields; field->type; field++) {
-        write_field(f, field, base);
+        write_field(b, field, base);
     }
 }
 
-static void read_data(void *buf, size_t len, FILE *f)
+static void read_data(savebuf_t *b, void *buf, size_t len)
 {
-    if (fread(buf, 1, len, f) != len) {
+    if (b->cursize - b->readcount < len) {
         gi.error("%s: couldn't read %"PRIz" bytes", __func__, len);
     }
+
+    memcpy(buf, b->data + b->readcount, len);
+    b->readcount += len;
 }
 
-static int read_short(FILE *f)
+static int read_short(savebuf_t *b)
 {
     short v;
 
-    read_data(&v, sizeof(v), f);
+    read_data(b, &v, sizeof(v));
     v = LittleShort(v);
 
     return v;
 }
 
-static int read_int(FILE *f)
+static int read_int(savebuf_t *b)
 {
     int v;
 
-    read_data(&v, sizeof(v), f);
+    read_data(b, &v, sizeof(v));
     v = LittleLong(v);
 
     return v;
 }
 
-static float read_float(FILE *f)
+static float read_float(savebuf_t *b)
 {
     float v;
 
-    read_data(&v, sizeof(v), f);
+    read_data(b, &v, sizeof(v));
     v = LittleFloat(v);
 
     return v;
 }
 
 
-static char *read_string(FILE *f)
+static char *read_string(savebuf_t *b)
 {
     int len;
     char *s;
 
-    len = read_int(f);
+    len = read_int(b);
     if (len == -1) {
         return NULL;
     }
@@ -632,38 +775,38 @@ static char *read_string(FILE *f)
     }
 
     s = gi.TagMalloc(len + 1, TAG_LEVEL);
-    read_data(s, len, f);
+    read_data(b, s, len);
     s[len] = 0;
 
     return s;
 }
 
-static void read_zstring(FILE *f, char *s, size_t size)
+static void read_zstring(savebuf_t *b, char *s, size_t size)
 {
     int len;
 
-    len = read_int(f);
+    len = read_int(b);
     if (len < 0 || len >= size) {
         gi.error("%s: bad length", __func__);
     }
 
-    read_data(s, len, f);
+    read_data(b, s, len);
     s[len] = 0;
 }
 
-static void read_vector(FILE *f, vec_t *v)
+static void read_vector(savebuf_t *b, vec_t *v)
 {
-    v[0] = read_float(f);
-    v[1] = read_float(f);
-    v[2] = read_float(f);
+    v[0] = read_float(b);
+    v[1] = read_float(b);
+    v[2] = read_float(b);
 }
 
-static void *read_index(FILE *f, size_t size, void *start, int max_index)
+static void *read_index(savebuf_t *b, size_t size, void *start, int max_index)
 {
     int index;
     byte *p;
 
-    index = read_int(f);
+    index = read_int(b);
     if (index == -1) {
         return NULL;
     }
@@ -676,12 +819,12 @@ static void *read_index(FILE *f, size_t size, void *start, int max_index)
     return p;
 }
 
-static void *read_pointer(FILE *f, ptr_type_t type)
+static void *read_pointer(savebuf_t *b, ptr_type_t type)
 {
     int index;
     const save_ptr_t *ptr;
 
-    index = read_int(f);
+    index = read_int(b);
     if (index == -1) {
         return NULL;
     }
@@ -698,53 +841,53 @@ static void *read_pointer(FILE *f, ptr_type_t type)
     return ptr->ptr;
 }
 
-static void read_field(FILE *f, const save_field_t *field, void *base)
+static void read_field(savebuf_t *b, const save_field_t *field, void *base)
 {
     void *p = (byte *)base + field->ofs;
     int i;
 
     switch (field->type) {
     case F_BYTE:
-        read_data(p, field->size, f);
+        read_data(b, p, field->size);
         break;
     case F_SHORT:
         for (i = 0; i < field->size; i++) {
-            ((short *)p)[i] = read_short(f);
+            ((short *)p)[i] = read_short(b);
         }
         break;
     case F_INT:
         for (i = 0; i < field->size; i++) {
-            ((int *)p)[i] = read_int(f);
+            ((int *)p)[i] = read_int(b);
         }
         break;
     case F_FLOAT:
         for (i = 0; i < field->size; i++) {
-            ((float *)p)[i] = read_float(f);
+            ((float *)p)[i] = read_float(b);
         }
         break;
     case F_VECTOR:
-        read_vector(f, (vec_t *)p);
+        read_vector(b, (vec_t *)p);
         break;
 
     case F_LSTRING:
-        *(char **)p = read_string(f);
+        *(char **)p = read_string(b);
         break;
     case F_ZSTRING:
-        read_zstring(f, (char *)p, field->size);
+        read_zstring(b, (char *)p, field->size);
         break;
 
     case F_EDICT:
-        *(edict_t **)p = read_index(f, sizeof(edict_t), g_edicts, game.maxentities - 1);
+        *(edict_t **)p = read_index(b, sizeof(edict_t), g_edicts, game.maxentities - 1);
         break;
     case F_CLIENT:
-        *(gclient_t **)p = read_index(f, sizeof(gclient_t), game.clients, game.maxclients - 1);
+        *(gclient_t **)p = read_index(b, sizeof(gclient_t), game.clients, game.maxclients - 1);
         break;
     case F_ITEM:
-        *(gitem_t **)p = read_index(f, sizeof(gitem_t), itemlist, game.num_items - 1);
+        *(gitem_t **)p = read_index(b, sizeof(gitem_t), itemlist, game.num_items - 1);
         break;
 
     case F_POINTER:
-        *(void **)p = read_pointer(f, field->size);
+        *(void **)p = read_pointer(b, field->size);
         break;
 
     default:
@@ -752,12 +895,12 @@ static void read_field(FILE *f, const save_field_t *field, void *base)
     }
 }
 
-static void read_fields(FILE *f, const save_field_t *fields, void *base)
+static void read_fields(savebuf_t *b, const save_field_t *fields, void *base)
 {
     const save_field_t *field;
 
     for (field = fields; field->type; field++) {
-        read_field(f, field, base);
+        read_field(b, field, base);
     }
 }
 
@@ -783,75 +926,73 @@ last save position.
 */
 void WriteGame(const char *filename, qboolean autosave)
 {
-    FILE    *f;
-    int     i;
+    savebuf_t   b;
+    int         i;
 
     if (!autosave)
         SaveClientData();
 
-    f = fopen(filename, "wb");
-    if (!f)
-        gi.error("Couldn't open %s", filename);
+    memset(&b, 0, sizeof(b));
 
-    write_int(f, SAVE_MAGIC1);
-    write_int(f, SAVE_VERSION);
+    write_int(&b, SAVE_MAGIC1);
+    write_int(&b, SAVE_VERSION);
 
     game.autosaved = autosave;
-    write_fields(f, gamefields, &game);
+    write_fields(&b, gamefields, &game);
     game.autosaved = qfalse;
 
     for (i = 0; i < game.maxclients; i++) {
-        write_fields(f, clientfields, &game.clients[i]);
+        write_fields(&b, clientfields, &game.clients[i]);
     }
 
-    fclose(f);
+    savebuf_writefile(&b, filename);
+    savebuf_free(&b);
 }
 
 void ReadGame(const char *filename)
 {
-    FILE    *f;
-    int     i;
+    savebuf_t   b;
+    int         i;
 
     gi.FreeTags(TAG_GAME);
 
-    f = fopen(filename, "rb");
-    if (!f)
-        gi.error("Couldn't open %s", filename);
+    savebuf_readfile(&b, filename);
 
-    i = read_int(f);
+    i = read_int(&b);
     if (i != SAVE_MAGIC1) {
-        fclose(f);
+        savebuf_free(&b);
         gi.error("Not a save game");
     }
 
-    i = read_int(f);
+    i = read_int(&b);
     if (i != SAVE_VERSION) {
-        fclose(f);
+        savebuf_free(&b);
         gi.error("Savegame from an older version");
     }
 
-    read_fields(f, gamefields, &game);
+    read_fields(&b, gamefields, &game);
 
     // should agree with server's version
     if (game.maxclients != (int)maxclients->value) {
-        fclose(f);
+        savebuf_free(&b);
         gi.error("Savegame has bad maxclients");
     }
     if (game.maxentities <= game.maxclients || game.maxentities > MAX_EDICTS) {
-        fclose(f);
+        savebuf_free(&b);
         gi.error("Savegame has bad maxentities");
     }
 
     g_edicts = gi.TagMalloc(game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
     globals.edicts = g_edicts;
     globals.max_edicts = game.maxentities;
+    G_InitFindIndex();
 
     game.clients = gi.TagMalloc(game.maxclients * sizeof(game.clients[0]), TAG_GAME);
     for (i = 0; i < game.maxclients; i++) {
-        read_fields(f, clientfields, &game.clients[i]);
+        read_fields(&b, clientfields, &game.clients[i]);
     }
 
-    fclose(f);
+    savebuf_free(&b);
 }
 
 //==========================================================
@@ -867,29 +1008,28 @@ void WriteLevel(const char *filename)
 {
     int     i;
     edict_t *ent;
-    FILE    *f;
+    savebuf_t b;
 
-    f = fopen(filename, "wb");
-    if (!f)
-        gi.error("Couldn't open %s", filename);
+    memset(&b, 0, sizeof(b));
 
-    write_int(f, SAVE_MAGIC2);
-    write_int(f, SAVE_VERSION);
+    write_int(&b, SAVE_MAGIC2);
+    write_int(&b, SAVE_VERSION);
 
     // write out level_locals_t
-    write_fields(f, levelfields, &level);
+    write_fields(&b, levelfields, &level);
 
     // write out all the entities
     for (i = 0; i < globals.num_edicts; i++) {
         ent = &g_edicts[i];
         if (!ent->inuse)
             continue;
-        write_int(f, i);
-        write_fields(f, entityfields, ent);
+        write_int(&b, i);
+        write_fields(&b, entityfields, ent);
     }
-    write_int(f, -1);
+    write_int(&b, -1);
 
-    fclose(f);
+    savebuf_writefile(&b, filename);
+    savebuf_free(&b);
 }
 
 
@@ -912,7 +1052,7 @@ No clients are connected yet.
 void ReadLevel(const char *filename)
 {
     int     entnum;
-    FILE    *f;
+    savebuf_t b;
     int     i;
     edict_t *ent;
 
@@ -920,32 +1060,31 @@ void ReadLevel(const char *filename)
     // base state
     gi.FreeTags(TAG_LEVEL);
 
-    f = fopen(filename, "rb");
-    if (!f)
-        gi.error("Couldn't open %s", filename);
+    savebuf_readfile(&b, filename);
 
     // wipe all the entities
     memset(g_edicts, 0, game.maxentities * sizeof(g_edicts[0]));
+    G_ClearFindIndex();
     globals.num_edicts = maxclients->value + 1;
 
-    i = read_int(f);
+    i = read_int(&b);
     if (i != SAVE_MAGIC2) {
-        fclose(f);
+        savebuf_free(&b);
         gi.error("Not a save game");
     }
 
-    i = read_int(f);
+    i = read_int(&b);
     if (i != SAVE_VERSION) {
-        fclose(f);
+        savebuf_free(&b);
         gi.error("Savegame from an older version");
     }
 
     // load the level locals
-    read_fields(f, levelfields, &level);
+    read_fields(&b, levelfields, &level);
 
     // load all the entities
     while (1) {
-        entnum = read_int(f);
+        entnum = read_int(&b);
         if (entnum == -1)
             break;
         if (entnum < 0 || entnum >= game.maxentities) {
@@ -955,16 +1094,17 @@ void ReadLevel(const char *filename)
             globals.num_edicts = entnum + 1;
 
         ent = &g_edicts[entnum];
-        read_fields(f, entityfields, ent);
+        read_fields(&b, entityfields, ent);
         ent->inuse = qtrue;
         ent->s.number = entnum;
+        G_IndexEdict(ent);
 
         // let the server rebuild world links for this ent
         memset(&ent->area, 0, sizeof(ent->area));
         gi.linkentity(ent);
     }
 
-    fclose(f);
+    savebuf_free(&b);
 
     // mark all clients as unconnected
     for (i = 0 ; i < maxclients->value ; i++) {
@@ -586,6 +586,7 @@ void SpawnEntities(const char *mapname, const char *entities, const char *spawnp
 
     memset(&level, 0, sizeof(level));
     memset(g_edicts, 0, game.maxentities * sizeof(g_edicts[0]));
+    G_ClearFindIndex();
 
     strncpy(level.mapname, mapname, sizeof(level.mapname) - 1);
     strncpy(game.spawnpoint, spawnpoint, sizeof(game.spawnpoint) - 1);
@@ -611,6 +612,7 @@ void SpawnEntities(const char *mapname, const char *entities, const char *spawnp
         else
             ent = G_Spawn();
         ED_ParseEdict(&entities, ent);
+        G_IndexEdict(ent);
 
         // yet another map hack
         if (!Q_stricmp(level.mapname, "command") && !Q_stricmp(ent->classname, "trigger_once") && !Q_stricmp(ent->model, "*27"))
@@ -17,6 +17,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "g_local.h"
+#include <time.h>
 
 
 void    Svcmd_Test_f(void)
@@ -24,6 +25,133 @@ void    Svcmd_Test_f(void)
     gi.cprintf(NULL, PRINT_HIGH, "Svcmd_Test_f()\n");
 }
 
+/*
+=================
+Svcmd_FindTest_f
+
+Looks up classname and targetname of every entity using both indexed and
+linear G_Find, verifies that results match and reports time spent.
+=================
+*/
+static int FindTest_Run(edict_t *(*find)(edict_t *, int, char *), int count, int *errors)
+{
+    edict_t *ent, *e1, *e2;
+    int     i, j, fieldofs;
+    char    *s;
+    clock_t start;
+
+    start = clock();
+    for (i = 0; i < count; i++) {
+        for (j = 0, ent = g_edicts; j < globals.num_edicts; j++, ent++) {
+            if (!ent->inuse)
+                continue;
+            fieldofs = (j & 1) ? FOFS(targetname) : FOFS(classname);
+            s = *(char **)((byte *)ent + fieldofs);
+            if (!s)
+                continue;
+            e1 = e2 = NULL;
+            do {
+                e1 = find(e1, fieldofs, s);
+                if (errors) {
+                    e2 = G_FindLinear(e2, fieldofs, s);
+                    if (e1 != e2)
+                        (*errors)++;
+                }
+            } while (e1 && (!errors || e1 == e2));
+        }
+    }
+
+    return (clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+static void Svcmd_FindTest_f(void)
+{
+    int count, errors, t1, t2;
+
+    count = atoi(gi.argv(2));
+    if (count < 1)
+        count = 1;
+
+    errors = 0;
+    FindTest_Run(G_Find, 1, &errors);
+
+    t1 = FindTest_Run(G_Find, count, NULL);
+    t2 = FindTest_Run(G_FindLinear, count, NULL);
+
+    gi.cprintf(NULL, PRINT_HIGH, "%d edicts, %d errors, %d msec indexed, %d msec linear\n",
+               globals.num_edicts, errors, t1, t2);
+}
+
+/*
+=================
+Svcmd_RadiusTest_f
+
+Spawns a number of grenades spread over the entity bounds and compares
+splash damage queries done by findradius and G_FindRadius around them.
+=================
+*/
+static void Svcmd_RadiusTest_f(void)
+{
+    static vec3_t origins[MAX_EDICTS];
+    edict_t *list1[MAX_EDICTS], *list2[MAX_EDICTS], *ent;
+    vec3_t  mins, maxs;
+    int     i, j, n1, n2, num, count, errors;
+    clock_t start, t1, t2;
+
+    // leave some free edicts so that G_Spawn never runs out
+    num = game.maxentities - globals.num_edicts - 64;
+    if (num < 1) {
+        gi.cprintf(NULL, PRINT_HIGH, "Not enough free edicts\n");
+        return;
+    }
+
+    count = atoi(gi.argv(2));
+    clamp(count, 1, num);
+
+    ClearBounds(mins, maxs);
+    for (i = 1, ent = g_edicts + 1; i < globals.num_edicts; i++, ent++) {
+        if (ent->inuse)
+            AddPointToBounds(ent->s.origin, mins, maxs);
+    }
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < 3; j++)
+            origins[i][j] = mins[j] + random() * (maxs[j] - mins[j]);
+        fire_grenade(g_edicts, origins[i], vec3_origin, 120, 600, 2.5, 160);
+    }
+
+    errors = 0;
+    t1 = t2 = 0;
+    for (i = 0; i < count; i++) {
+        start = clock();
+        ent = NULL;
+        for (n1 = 0; (ent = findradius(ent, origins[i], 160)) != NULL; n1++)
+            list1[n1] = ent;
+        t1 += clock() - start;
+
+        start = clock();
+        num = G_FindRadius(origins[i], 160, list2, MAX_EDICTS);
+        for (j = n2 = 0; j < num; j++) {
+            if (G_InRadius(list2[j], origins[i], 160))
+                list2[n2++] = list2[j];
+        }
+        t2 += clock() - start;
+
+        if (n1 != n2 || memcmp(list1, list2, n1 * sizeof(list1[0])))
+            errors++;
+    }
+
+    ent = NULL;
+    while ((ent = G_Find(ent, FOFS(classname), "grenade")) != NULL) {
+        if (ent->owner == g_edicts)
+            G_FreeEdict(ent);
+    }
+
+    gi.cprintf(NULL, PRINT_HIGH, "%d edicts, %d queries, %d errors, %d msec linear, %d msec indexed\n",
+               globals.num_edicts, count, errors,
+               (int)(t1 * 1000 / CLOCKS_PER_SEC), (int)(t2 * 1000 / CLOCKS_PER_SEC));
+}
+
 /*
 ==============================================================================
 
@@ -279,6 +407,10 @@ void    ServerCommand(void)
     cmd = gi.argv(1);
     if (Q_stricmp(cmd, "test") == 0)
         Svcmd_Test_f();
+    else if (Q_stricmp(cmd, "findtest") == 0)
+        Svcmd_FindTest_f();
+    else if (Q_stricmp(cmd, "radiustest") == 0)
+        Svcmd_RadiusTest_f();
     else if (Q_stricmp(cmd, "addip") == 0)
         SVCmd_AddIP_f();
     else if (Q_stricmp(cmd, "removeip") == 0)
@@ -372,7 +372,7 @@ void use_target_spawner(edict_t *self, edict_t *other, edict_t *activator)
     edict_t *ent;
 
     ent = G_Spawn();
-    ent->classname = self->target;
+    G_SetClassname(ent, self->target);
     VectorCopy(self->s.origin, ent->s.origin);
     VectorCopy(self->s.angles, ent->s.angles);
     ED_CallSpawn(ent);
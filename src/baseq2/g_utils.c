@@ -28,19 +28,180 @@ void G_ProjectSource(const vec3_t point, const vec3_t distance, const vec3_t for
 }
 
 
+/*
+=============================================================================
+
+FIND INDEX
+
+Entities are hashed by classname and targetname, so that G_Find doesn't have
+to compare strings of every entity. Hash chains are kept sorted by entity
+number to preserve G_Find iteration order. Candidates are always verified, so
+stale links are harmless, but any change of an indexed field must be followed
+by G_IndexEdict for the entity to be found.
+
+=============================================================================
+*/
+
+#define FIND_HASH_SIZE  1024
+
+enum {
+    FIND_CLASSNAME,
+    FIND_TARGETNAME,
+
+    FIND_NUM_FIELDS
+};
+
+typedef struct {
+    char        *key;       // indexed value, NULL if not linked
+    unsigned    hash;
+    int         prev, next; // entity numbers, -1 terminates chain
+} findlink_t;
+
+static findlink_t   *find_links[FIND_NUM_FIELDS];   // [game.maxentities]
+static int          find_heads[FIND_NUM_FIELDS][FIND_HASH_SIZE];
+static int          find_tails[FIND_NUM_FIELDS][FIND_HASH_SIZE];
+
+static unsigned find_hash(const char *s)
+{
+    unsigned hash = 0;
+
+    while (*s)
+        hash = hash * 31 + Q_tolower(*s++);
+
+    return hash & (FIND_HASH_SIZE - 1);
+}
+
+static char *find_field(edict_t *ent, int field)
+{
+    return field == FIND_CLASSNAME ? ent->classname : ent->targetname;
+}
+
+static void find_unlink(int field, int num)
+{
+    findlink_t *links = find_links[field];
+    findlink_t *link = &links[num];
+
+    if (link->prev == -1)
+        find_heads[field][link->hash] = link->next;
+    else
+        links[link->prev].next = link->next;
+
+    if (link->next == -1)
+        find_tails[field][link->hash] = link->prev;
+    else
+        links[link->next].prev = link->prev;
+
+    link->key = NULL;
+}
+
+static void find_link(int field, int num, char *key)
+{
+    findlink_t *links = find_links[field];
+    findlink_t *link = &links[num];
+    unsigned hash = find_hash(key);
+    int i, *head = &find_heads[field][hash], *tail = &find_tails[field][hash];
+
+    link->key = key;
+    link->hash = hash;
+
+    // entities are mostly indexed in increasing order, check tail first
+    if (*tail == -1 || *tail < num) {
+        link->prev = *tail;
+        link->next = -1;
+        if (*tail == -1)
+            *head = num;
+        else
+            links[*tail].next = num;
+        *tail = num;
+        return;
+    }
+
+    for (i = *head; i < num; i = links[i].next)
+        ;
+
+    link->prev = links[i].prev;
+    link->next = i;
+    if (links[i].prev == -1)
+        *head = num;
+    else
+        links[links[i].prev].next = num;
+    links[i].prev = num;
+}
+
 /*
 =============
-G_Find
+G_IndexEdict
 
-Searches all active entities for the next one that holds
-the matching string at fieldofs (use the FOFS() macro) in the structure.
+Updates find index after classname or targetname of the entity has changed.
+=============
+*/
+void G_IndexEdict(edict_t *ent)
+{
+    int     field, num = ent - g_edicts;
+    char    *s;
 
-Searches beginning at the edict after from, or the beginning if NULL
-NULL will be returned if the end of the list is reached.
+    for (field = 0; field < FIND_NUM_FIELDS; field++) {
+        s = find_field(ent, field);
+        if (find_links[field][num].key == s)
+            continue;
+        if (find_links[field][num].key)
+            find_unlink(field, num);
+        if (s)
+            find_link(field, num, s);
+    }
+}
+
+void G_SetClassname(edict_t *ent, char *classname)
+{
+    ent->classname = classname;
+    G_IndexEdict(ent);
+}
+
+void G_SetTargetname(edict_t *ent, char *targetname)
+{
+    ent->targetname = targetname;
+    G_IndexEdict(ent);
+}
 
+/*
+=============
+G_ClearFindIndex
+
+Must be called whenever g_edicts array is wiped.
 =============
 */
-edict_t *G_Find(edict_t *from, int fieldofs, char *match)
+void G_ClearFindIndex(void)
+{
+    int field, i;
+
+    for (field = 0; field < FIND_NUM_FIELDS; field++) {
+        for (i = 0; i < game.maxentities; i++)
+            find_links[field][i].key = NULL;
+        for (i = 0; i < FIND_HASH_SIZE; i++) {
+            find_heads[field][i] = -1;
+            find_tails[field][i] = -1;
+        }
+    }
+}
+
+void G_InitFindIndex(void)
+{
+    int field;
+
+    for (field = 0; field < FIND_NUM_FIELDS; field++)
+        find_links[field] = gi.TagMalloc(game.maxentities * sizeof(findlink_t), TAG_GAME);
+
+    G_ClearFindIndex();
+}
+
+/*
+=============
+G_FindLinear
+
+Reference implementation of G_Find that doesn't use the index.
+=============
+*/
+edict_t *G_FindLinear(edict_t *from, int fieldofs, char *match)
 {
     char    *s;
 
@@ -62,6 +223,87 @@ edict_t *G_Find(edict_t *from, int fieldofs, char *match)
     return NULL;
 }
 
+/*
+=============
+G_Find
+
+Searches all active entities for the next one that holds
+the matching string at fieldofs (use the FOFS() macro) in the structure.
+
+Searches beginning at the edict after from, or the beginning if NULL
+NULL will be returned if the end of the list is reached.
+
+=============
+*/
+edict_t *G_Find(edict_t *from, int fieldofs, char *match)
+{
+    findlink_t  *links;
+    edict_t     *ent;
+    unsigned    hash;
+    int         field, i, num;
+    char        *s;
+
+    if (fieldofs == FOFS(classname))
+        field = FIND_CLASSNAME;
+    else if (fieldofs == FOFS(targetname))
+        field = FIND_TARGETNAME;
+    else
+        return G_FindLinear(from, fieldofs, match);
+
+    links = find_links[field];
+    hash = find_hash(match);
+
+    if (!from) {
+        i = find_heads[field][hash];
+    } else {
+        num = from - g_edicts;
+        if (links[num].key && links[num].hash == hash) {
+            // common case of iterating over matches
+            i = links[num].next;
+        } else {
+            for (i = find_heads[field][hash]; i != -1 && i <= num; i = links[i].next)
+                ;
+        }
+    }
+
+    for (; i != -1 && i < globals.num_edicts; i = links[i].next) {
+        ent = &g_edicts[i];
+        if (!ent->inuse)
+            continue;
+        s = find_field(ent, field);
+        if (!s)
+            continue;
+        if (!Q_stricmp(s, match))
+            return ent;
+    }
+
+    return NULL;
+}
+
+
+/*
+=================
+G_InRadius
+
+Returns true if entity would be returned by findradius.
+=================
+*/
+qboolean G_InRadius(edict_t *ent, vec3_t org, float rad)
+{
+    vec3_t  eorg;
+    int     j;
+
+    if (!ent->inuse)
+        return qfalse;
+    if (ent->solid == SOLID_NOT)
+        return qfalse;
+    for (j = 0 ; j < 3 ; j++)
+        eorg[j] = org[j] - (ent->s.origin[j] + (ent->mins[j] + ent->maxs[j]) * 0.5);
+    if (VectorLength(eorg) > rad)
+        return qfalse;
+
+    return qtrue;
+}
 
 /*
 =================
@@ -74,28 +316,65 @@ findradius (origin, radius)
 */
 edict_t *findradius(edict_t *from, vec3_t org, float rad)
 {
-    vec3_t  eorg;
-    int     j;
-
     if (!from)
         from = g_edicts;
     else
         from++;
     for (; from < &g_edicts[globals.num_edicts]; from++) {
-        if (!from->inuse)
-            continue;
-        if (from->solid == SOLID_NOT)
-            continue;
-        for (j = 0 ; j < 3 ; j++)
-            eorg[j] = org[j] - (from->s.origin[j] + (from->mins[j] + from->maxs[j]) * 0.5);
-        if (VectorLength(eorg) > rad)
-            continue;
-        return from;
+        if (G_InRadius(from, org, rad))
+            return from;
     }
 
     return NULL;
 }
 
+static int entnumcmp(const void *p1, const void *p2)
+{
+    edict_t *e1 = *(edict_t **)p1;
+    edict_t *e2 = *(edict_t **)p2;
+
+    return (e1 > e2) - (e1 < e2);
+}
+
+/*
+=================
+G_FindRadius
+
+Fills the list with candidate entities for a spherical area query, sorted
+in the order findradius would return them. Uses the server area tree
+instead of checking every entity. Caller should test each candidate with
+G_InRadius as it goes, since entities may be freed or moved meanwhile.
+
+Unlike findradius, only linked entities are found, and entities spawned
+while the caller walks the list are not visited. Solid entities are only
+unlinked for a moment while they are teleported or respawned, and what gets
+spawned during splash damage (gibs, debris, dropped items) can't take damage
+or be healed, so none of the callers miss anything they act on.
+=================
+*/
+int G_FindRadius(vec3_t org, float rad, edict_t **list, int maxcount)
+{
+    vec3_t  mins, maxs;
+    int     i, count;
+
+    for (i = 0; i < 3; i++) {
+        mins[i] = org[i] - rad;
+        maxs[i] = org[i] + rad;
+    }
+
+    count = 0;
+
+    // world is never linked, check it explicitly
+    if (count < maxcount && G_InRadius(g_edicts, org, rad))
+        list[count++] = g_edicts;
+
+    count += gi.BoxEdicts(mins, maxs, list + count, maxcount - count, AREA_SOLID);
+    count += gi.BoxEdicts(mins, maxs, list + count, maxcount - count, AREA_TRIGGERS);
+
+    qsort(list, count, sizeof(list[0]), entnumcmp);
+    return count;
+}
+
 
 /*
 =============
@@ -173,7 +452,7 @@ void G_UseTargets(edict_t *ent, edict_t *activator)
     if (ent->delay) {
         // create a temp object to fire at a later time
         t = G_Spawn();
-        t->classname = "DelayedUse";
+        G_SetClassname(t, "DelayedUse");
         t->nextthink = level.time + ent->delay;
         t->think = Think_Delay;
         t->activator = activator;
@@ -375,6 +654,7 @@ void G_InitEdict(edict_t *e)
     e->classname = "noclass";
     e->gravity = 1.0;
     e->s.number = e - g_edicts;
+    G_IndexEdict(e);
 }
 
 /*
@@ -431,6 +711,7 @@ void G_FreeEdict(edict_t *ed)
     ed->classname = "freed";
     ed->freetime = level.time;
     ed->inuse = qfalse;
+    G_IndexEdict(ed);
 }
 
 
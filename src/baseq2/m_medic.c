@@ -43,10 +43,15 @@ static int  sound_hook_retract;
 
 edict_t *medic_FindDeadMonster(edict_t *self)
 {
-    edict_t *ent = NULL;
+    edict_t *touch[MAX_EDICTS], *ent;
     edict_t *best = NULL;
+    int     i, num;
 
-    while ((ent = findradius(ent, self->s.origin, 1024)) != NULL) {
+    num = G_FindRadius(self->s.origin, 1024, touch, MAX_EDICTS);
+    for (i = 0 ; i < num ; i++) {
+        ent = touch[i];
+        if (!G_InRadius(ent, self->s.origin, 1024))
+            continue;
         if (ent == self)
             continue;
         if (!(ent->svflags & SVF_MONSTER))
@@ -588,7 +593,7 @@ void medic_cable_attack(edict_t *self)
         self->enemy->spawnflags = 0;
         self->enemy->monsterinfo.aiflags = 0;
         self->enemy->target = NULL;
-        self->enemy->targetname = NULL;
+        G_SetTargetname(self->enemy, NULL);
         self->enemy->combattarget = NULL;
         self->enemy->deathtarget = NULL;
         self->enemy->owner = self;
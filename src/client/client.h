@@ -60,6 +60,7 @@ typedef struct centity_s {
     entity_state_t    prev;            // will always be valid, but might just be a copy of current
 
     vec3_t          mins, maxs;
+    vec3_t          absmin, absmax;     // world bounds for trace rejection
 
     int             serverframe;        // if not current, this ent isn't in the frame
 
@@ -98,6 +99,18 @@ typedef struct {
     unsigned    cmdNumber;    // current cmdNumber for this frame
 } client_history_t;
 
+// prediction state after the last replayed usercmd, extended incrementally
+// until a new server frame or acknowledgement invalidates it
+typedef struct {
+    qboolean        valid;
+    int             frame;      // server frame number replay started from
+    unsigned        ack;        // last cmdNumber acknowledged by that frame
+    unsigned        cmdNumber;  // last cmdNumber replayed
+    pmove_state_t   base;       // initial state replay started from
+    pmove_state_t   s;
+    vec3_t          viewangles;
+} client_predict_t;
+
 typedef struct {
     qboolean        valid;
 
@@ -168,6 +181,8 @@ typedef struct client_state_s {
     vec3_t      predicted_velocity;
     vec3_t      prediction_error;
 
+    client_predict_t    predicted_cache;
+
     // rebuilt each valid frame
     centity_t       *solidEntities[MAX_PACKET_ENTITIES];
     int             numSolidEntities;
@@ -580,6 +595,7 @@ typedef enum {
 void CL_ParsePlayerSkin(char *name, char *model, char *skin, const char *s);
 void CL_LoadClientinfo(clientinfo_t *ci, const char *s);
 void CL_LoadState(load_state_t state);
+void CL_PrefetchFiles(void);
 void CL_RegisterSounds(void);
 void CL_RegisterBspModels(void);
 void CL_RegisterVWepModels(void);
@@ -731,6 +747,7 @@ void CL_InitTEnts(void);
 void CL_PredictAngles(void);
 void CL_PredictMovement(void);
 void CL_CheckPredictionError(void);
+void CL_SetSolidBounds(void);
 
 
 //
@@ -979,6 +996,12 @@ void CL_GTV_Shutdown(void);
 #define CL_GTV_Shutdown()               (void)0
 #endif
 
+//
+// prof.c
+//
+void CL_InitProf(void);
+void CL_ProfEndFrame(void);
+
 //
 // crc.c
 //
@@ -322,7 +322,7 @@ static void CL_Record_f(void)
     entity_packed_t pack;
     char            *s;
     qhandle_t       f;
-    unsigned        mode = FS_MODE_WRITE;
+    unsigned        mode = FS_MODE_WRITE | FS_FLAG_ASYNC;
     size_t          size = Cvar_ClampInteger(
                                cl_demomsglen,
                                MIN_PACKETLEN,
@@ -669,7 +669,9 @@ static int parse_next_message(int wait)
         return -1;
     }
 
+    CL_PROF_START(CL_PROF_PARSE);
     CL_ParseServerMessage();
+    CL_PROF_STOP(CL_PROF_PARSE);
 
     // if recording demo, write the message out
     if (cls.demo.recording && !cls.demo.paused && CL_FRAMESYNC) {
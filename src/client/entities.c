@@ -392,6 +392,8 @@ void CL_DeltaFrame(void)
         entity_event(state->number);
     }
 
+    CL_SetSolidBounds();
+
     if (cls.demo.recording && !cls.demo.paused && !cls.demo.seeking && CL_FRAMESYNC) {
         CL_EmitDemoFrame();
     }
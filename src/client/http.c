@@ -870,6 +870,8 @@ fail2:
                             dl->path, dl->queue->path, strerror(errno));
             dl->path[0] = 0;
 
+            FS_InvalidatePath(dl->queue->path);
+
             //a pak file is very special...
             if (dl->queue->type == DL_PAK) {
                 CL_RestartFilesystem(qfalse);
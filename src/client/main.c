@@ -774,6 +774,11 @@ void CL_Disconnect(error_type_t type)
 
     CL_ClearState();
 
+    // don't hold on to a map of the server we are leaving
+    if (!sv_running->integer) {
+        BSP_Preload(NULL);
+    }
+
     CL_GTV_Suspend();
 
     cls.state = ca_disconnected;
@@ -1096,6 +1101,15 @@ static void CL_Changing_f(void)
         }
     }
 
+    // the remote server is still spawning the map, get a head start on
+    // loading it (a local server has loaded it already and preloads the next).
+    // Models and images aren't known until the new configstrings arrive,
+    // CL_Begin prefetches those.
+    if (cl.mapname[0] && !strchr(cl.mapname, '.') && !cls.demo.playback &&
+        !sv_running->integer) {
+        BSP_Preload(va("maps/%s.bsp", cl.mapname));
+    }
+
     SCR_UpdateScreen();
 }
 
@@ -1566,7 +1580,9 @@ static void CL_PacketEvent(void)
     cls.errorReceived = qfalse; // don't drop
 #endif
 
+    CL_PROF_START(CL_PROF_PARSE);
     CL_ParseServerMessage();
+    CL_PROF_STOP(CL_PROF_PARSE);
 
     // if recording demo, write the message out
     if (cls.demo.recording && !cls.demo.paused && CL_FRAMESYNC) {
@@ -1756,9 +1772,11 @@ void CL_Begin(void)
 
     Cvar_FixCheats();
 
+    CL_PrefetchFiles();
     CL_PrepRefresh();
     CL_LoadState(LOAD_SOUNDS);
     CL_RegisterSounds();
+    FS_StopPrefetch();
     LOC_LoadLocations();
     CL_LoadState(LOAD_NONE);
     cls.state = ca_precached;
@@ -2654,6 +2672,7 @@ static void CL_InitLocal(void)
     CL_InitTEnts();
     CL_InitDownloads();
     CL_GTV_Init();
+    CL_InitProf();
 
     List_Init(&cl_ignores);
 
@@ -3126,6 +3145,9 @@ unsigned CL_Frame(unsigned msec)
     main_extra += msec;
     cls.realtime += msec;
 
+    // restarted on every call, only finished frames are accounted
+    CL_PROF_START(CL_PROF_FRAME);
+
     CL_ProcessEvents();
 
     ref_frame = phys_frame = qtrue;
@@ -3236,7 +3258,9 @@ unsigned CL_Frame(unsigned msec)
     CL_SendCmd();
 
     // predict all unacknowledged movements
+    CL_PROF_START(CL_PROF_PREDICT);
     CL_PredictMovement();
+    CL_PROF_STOP(CL_PROF_PREDICT);
 
     Con_RunConsole();
 
@@ -3247,7 +3271,9 @@ unsigned CL_Frame(unsigned msec)
         if (host_speeds->integer)
             time_before_ref = Sys_Milliseconds();
 
+        CL_PROF_START(CL_PROF_SCREEN);
         SCR_UpdateScreen();
+        CL_PROF_STOP(CL_PROF_SCREEN);
 
         if (host_speeds->integer)
             time_after_ref = Sys_Milliseconds();
@@ -3257,7 +3283,9 @@ unsigned CL_Frame(unsigned msec)
 
 run_fx:
         // update audio after the 3D view was drawn
+        CL_PROF_START(CL_PROF_SOUND);
         S_Update();
+        CL_PROF_STOP(CL_PROF_SOUND);
 
         // advance local effects for next frame
 #if USE_DLIGHTS
@@ -3281,6 +3309,9 @@ run_fx:
 
     CL_MeasureStats();
 
+    CL_PROF_STOP(CL_PROF_FRAME);
+    CL_ProfEndFrame();
+
     cls.framecount++;
 
     main_extra = 0;
@@ -194,6 +194,54 @@ void CL_LoadClientinfo(clientinfo_t *ci, const char *s)
     }
 }
 
+/*
+=================
+CL_PrefetchFiles
+
+Queues the models, pics and sounds about to be registered, so that a
+thread reads them into the OS cache while the world is being loaded.
+Registration still decodes and uploads them on the main thread.
+=================
+*/
+void CL_PrefetchFiles(void)
+{
+    char    buffer[MAX_QPATH];
+    char    *s;
+    int     i;
+
+    for (i = 2; i < MAX_MODELS; i++) {
+        s = cl.configstrings[CS_MODELS + i];
+        if (!s[0])
+            break;
+        if (s[0] != '#' && s[0] != '*')
+            FS_PrefetchFile(s);
+    }
+
+    for (i = 1; i < MAX_IMAGES; i++) {
+        s = cl.configstrings[CS_IMAGES + i];
+        if (!s[0])
+            break;
+        if (s[0] == '/' || s[0] == '\\') {
+            FS_PrefetchFile(s + 1);
+        } else if (Q_concat(buffer, sizeof(buffer), "pics/", s, NULL) < sizeof(buffer) &&
+                   COM_DefaultExtension(buffer, ".pcx", sizeof(buffer)) < sizeof(buffer)) {
+            FS_PrefetchFile(buffer);
+        }
+    }
+
+    for (i = 1; i < MAX_SOUNDS; i++) {
+        s = cl.configstrings[CS_SOUNDS + i];
+        if (!s[0])
+            break;
+        if (s[0] == '#')
+            FS_PrefetchFile(s + 1);
+        else if (s[0] != '*' && Q_concat(buffer, sizeof(buffer), "sound/", s, NULL) < sizeof(buffer))
+            FS_PrefetchFile(buffer);
+    }
+
+    FS_StartPrefetch();
+}
+
 /*
 =================
 CL_RegisterSounds
@@ -204,6 +252,7 @@ void CL_RegisterSounds(void)
     int i;
     char    *s;
 
+    FS_BeginRegistration();
     S_BeginRegistration();
     CL_RegisterTEntSounds();
     for (i = 1; i < MAX_SOUNDS; i++) {
@@ -213,6 +262,7 @@ void CL_RegisterSounds(void)
         cl.sound_precache[i] = S_RegisterSound(s);
     }
     S_EndRegistration();
+    FS_EndRegistration();
 }
 
 /*
@@ -335,6 +385,7 @@ void CL_PrepRefresh(void)
         return;     // no map loaded
 
     // register models, pics, and skins
+    FS_BeginRegistration();
     R_BeginRegistration(cl.mapname);
 
     CL_LoadState(LOAD_MODELS);
@@ -377,6 +428,7 @@ void CL_PrepRefresh(void)
 
     // the renderer can now free unneeded stuff
     R_EndRegistration();
+    FS_EndRegistration();
 
     // clear any lines of console text
     Con_ClearNotify_f();
@@ -71,6 +71,66 @@ void CL_CheckPredictionError(void)
     VectorScale(delta, 0.125f, cl.prediction_error);
 }
 
+/*
+====================
+CL_SetSolidBounds
+
+Calculates world bounds of solid entities once per server frame,
+so that traces can reject entities they can't possibly touch.
+====================
+*/
+void CL_SetSolidBounds(void)
+{
+    int         i;
+    centity_t   *ent;
+    mmodel_t    *cmodel;
+    vec_t       radius;
+
+    for (i = 0; i < cl.numSolidEntities; i++) {
+        ent = cl.solidEntities[i];
+
+        if (ent->current.solid == PACKED_BSP) {
+            cmodel = cl.model_clip[ent->current.modelindex];
+            if (!cmodel) {
+                // may get registered later, leave it to narrowphase
+                VectorSet(ent->absmin, -INFINITY, -INFINITY, -INFINITY);
+                VectorSet(ent->absmax, INFINITY, INFINITY, INFINITY);
+                continue;
+            }
+            if (ent->current.angles[0] || ent->current.angles[1] || ent->current.angles[2]) {
+                // expand for rotation
+                radius = RadiusFromBounds(cmodel->mins, cmodel->maxs);
+                VectorSet(ent->absmin, -radius, -radius, -radius);
+                VectorSet(ent->absmax, radius, radius, radius);
+            } else {
+                VectorCopy(cmodel->mins, ent->absmin);
+                VectorCopy(cmodel->maxs, ent->absmax);
+            }
+        } else {
+            // box hulls are never rotated
+            VectorCopy(ent->mins, ent->absmin);
+            VectorCopy(ent->maxs, ent->absmax);
+        }
+
+        // expand by one unit to be safe against epsilons
+        VectorAdd(ent->absmin, ent->current.origin, ent->absmin);
+        VectorAdd(ent->absmax, ent->current.origin, ent->absmax);
+        ent->absmin[0] -= 1;
+        ent->absmin[1] -= 1;
+        ent->absmin[2] -= 1;
+        ent->absmax[0] += 1;
+        ent->absmax[1] += 1;
+        ent->absmax[2] += 1;
+    }
+}
+
+static inline qboolean CL_BoundsOverlap(const centity_t *ent, const vec3_t mins, const vec3_t maxs)
+{
+    return mins[0] <= ent->absmax[0] && maxs[0] >= ent->absmin[0]
+        && mins[1] <= ent->absmax[1] && maxs[1] >= ent->absmin[1]
+        && mins[2] <= ent->absmax[2] && maxs[2] >= ent->absmin[2];
+}
+
 /*
 ====================
 CL_ClipMoveToEntities
@@ -84,10 +144,25 @@ static void CL_ClipMoveToEntities(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t
     mnode_t     *headnode;
     centity_t   *ent;
     mmodel_t    *cmodel;
+    vec3_t      boxmins, boxmaxs;
+
+    // bounds of the whole move
+    for (i = 0; i < 3; i++) {
+        if (end[i] > start[i]) {
+            boxmins[i] = start[i] + mins[i];
+            boxmaxs[i] = end[i] + maxs[i];
+        } else {
+            boxmins[i] = end[i] + mins[i];
+            boxmaxs[i] = start[i] + maxs[i];
+        }
+    }
 
     for (i = 0; i < cl.numSolidEntities; i++) {
         ent = cl.solidEntities[i];
 
+        if (!CL_BoundsOverlap(ent, boxmins, boxmaxs))
+            continue;
+
         if (ent->current.solid == PACKED_BSP) {
             // special value for bmodel
             cmodel = cl.model_clip[ent->current.modelindex];
@@ -145,6 +220,9 @@ static int CL_PointContents(vec3_t point)
         if (ent->current.solid != PACKED_BSP) // special value for bmodel
             continue;
 
+        if (!CL_BoundsOverlap(ent, point, point))
+            continue;
+
         cmodel = cl.model_clip[ent->current.modelindex];
         if (!cmodel)
             continue;
@@ -177,6 +255,7 @@ void CL_PredictMovement(void)
     unsigned    ack, current, frame;
     pmove_t     pm;
     int         step, oldz;
+    client_predict_t    *cache;
 
     if (cls.state != ca_active) {
         return;
@@ -223,6 +302,21 @@ void CL_PredictMovement(void)
     VectorCopy(cl.delta_angles, pm.s.delta_angles);
 #endif
 
+    // continue from cached state if nothing it depends on has changed
+    cache = &cl.predicted_cache;
+    if (cache->valid && cache->frame == cl.frame.number && cache->ack == ack &&
+        cache->cmdNumber - ack <= current - ack &&
+        !memcmp(&cache->base, &pm.s, sizeof(pm.s))) {
+        pm.s = cache->s;
+        VectorCopy(cache->viewangles, pm.viewangles);
+        ack = cache->cmdNumber;
+    } else {
+        cache->valid = qtrue;
+        cache->frame = cl.frame.number;
+        cache->ack = ack;
+        cache->base = pm.s;
+    }
+
     // run frames
     while (++ack <= current) {
         pm.cmd = cl.cmds[ack & CMD_MASK];
@@ -232,6 +326,10 @@ void CL_PredictMovement(void)
         VectorCopy(pm.s.origin, cl.predicted_origins[ack & CMD_MASK]);
     }
 
+    cache->cmdNumber = current;
+    cache->s = pm.s;
+    VectorCopy(pm.viewangles, cache->viewangles);
+
     // run pending cmd
     if (cl.cmd.msec) {
         pm.cmd = cl.cmd;
@@ -0,0 +1,231 @@
+/*
+Copyright (C) 2003-2008 Andrey Nazarov
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+//
+// prof.c -- client frame CPU profiling scopes
+//
+
+#include "client.h"
+#include "common/trace.h"
+
+/*
+==============================================================================
+
+CPU PROFILER
+
+Scopes listed in CL_PROF_LIST are timed on the CPU while cl_profile is set.
+Totals of the last finished client frame are shown next to the GPU timings
+by the renderer profiler overlay.
+
+Every scope also goes into a ring buffer of recent events, together with
+GPU timestamps the renderer reports once query results come back. GPU
+events carry the number of the client frame that recorded them, so both
+timelines line up per frame. "profdump" writes the ring buffer out in
+Chrome trace event format.
+
+==============================================================================
+*/
+
+#define PROF_EVENTS     0x8000      // must be power of two
+
+typedef struct {
+    const char  *name;
+    unsigned    frame;
+    uint64_t    start;
+    unsigned    dur;
+    int         track;
+} profevent_t;
+
+enum {
+    TRACK_CPU = 1,
+    TRACK_GPU
+};
+
+static struct {
+    unsigned    framenum;
+    uint64_t    start[CL_PROF_NUM_SCOPES];
+    unsigned    cur[CL_PROF_NUM_SCOPES];
+    unsigned    last[CL_PROF_NUM_SCOPES];
+
+    profevent_t events[PROF_EVENTS];
+    unsigned    head;
+} prof;
+
+static const char *const prof_names[CL_PROF_NUM_SCOPES] = {
+#define CL_PROF_DO(id, name) name,
+    CL_PROF_LIST
+#undef CL_PROF_DO
+};
+
+qboolean    cl_prof_active;
+
+static cvar_t   *cl_profile;
+
+static void add_event(const char *name, unsigned frame,
+                      uint64_t start, unsigned dur, int track)
+{
+    profevent_t *ev = &prof.events[prof.head++ & (PROF_EVENTS - 1)];
+
+    ev->name = name;
+    ev->frame = frame;
+    ev->start = start;
+    ev->dur = dur;
+    ev->track = track;
+}
+
+void CL_ProfStart(clprof_t scope)
+{
+    prof.start[scope] = Sys_Microseconds();
+}
+
+void CL_ProfStop(clprof_t scope)
+{
+    uint64_t start = prof.start[scope];
+    unsigned dur;
+
+    // started before profiling was turned on
+    if (!start)
+        return;
+
+    dur = Sys_Microseconds() - start;
+    prof.start[scope] = 0;
+    prof.cur[scope] += dur;
+    add_event(prof_names[scope], prof.framenum, start, dur, TRACK_CPU);
+}
+
+/*
+==================
+CL_ProfGpuEvent
+
+Called by the renderer with start already mapped to Sys_Microseconds time.
+==================
+*/
+void CL_ProfGpuEvent(unsigned frame, const char *name, uint64_t start, unsigned dur)
+{
+    if (cl_prof_active)
+        add_event(name, frame, start, dur, TRACK_GPU);
+}
+
+// frame number to tag asynchronous results with, never zero
+unsigned CL_ProfFrame(void)
+{
+    return prof.framenum;
+}
+
+float CL_ProfLastMsec(clprof_t scope)
+{
+    return prof.last[scope] * 0.001f;
+}
+
+const char *CL_ProfName(clprof_t scope)
+{
+    return prof_names[scope];
+}
+
+void CL_ProfEndFrame(void)
+{
+    if (!cl_prof_active)
+        return;
+
+    memcpy(prof.last, prof.cur, sizeof(prof.last));
+    memset(prof.cur, 0, sizeof(prof.cur));
+    prof.framenum++;
+}
+
+/*
+==================
+CL_ProfDump_f
+
+profdump <filename>
+==================
+*/
+static void CL_ProfDump_f(void)
+{
+    char buffer[MAX_OSPATH];
+    profevent_t *ev;
+    unsigned i, count;
+    uint64_t base;
+    qhandle_t f;
+    ssize_t ret;
+
+    if (Cmd_Argc() != 2) {
+        Com_Printf("Usage: %s <filename>\n", Cmd_Argv(0));
+        return;
+    }
+
+    count = min(prof.head, PROF_EVENTS);
+    if (!count) {
+        Com_Printf("No events recorded. Set cl_profile to 1 to enable.\n");
+        return;
+    }
+
+    f = FS_EasyOpenFile(buffer, sizeof(buffer), FS_MODE_WRITE,
+                        "profile/", Cmd_Argv(1), ".json");
+    if (!f) {
+        return;
+    }
+
+    // GPU events may be older than the oldest CPU event still in the ring
+    base = UINT64_MAX;
+    for (i = 0; i < count; i++)
+        base = min(base, prof.events[i].start);
+
+    Com_TraceBegin(f, TRACK_CPU, "cpu");
+    Com_TraceThread(f, TRACK_GPU, "gpu");
+
+    for (i = prof.head - count; i != prof.head; i++) {
+        ev = &prof.events[i & (PROF_EVENTS - 1)];
+        Com_TraceEvent(f, ev->name, ev->track, (unsigned)(ev->start - base),
+                       ev->dur, ev->frame);
+    }
+
+    ret = Com_TraceEnd(f);
+
+    if (ret < 0)
+        Com_EPrintf("Error writing %s\n", buffer);
+    else
+        Com_Printf("Wrote %u events to %s\n", count, buffer);
+}
+
+static void cl_profile_changed(cvar_t *self)
+{
+    // scopes already running have no start time
+    if (self->integer && !cl_prof_active) {
+        memset(prof.start, 0, sizeof(prof.start));
+        memset(prof.cur, 0, sizeof(prof.cur));
+    }
+
+    cl_prof_active = !!self->integer;
+}
+
+static const cmdreg_t c_prof[] = {
+    { "profdump", CL_ProfDump_f },
+
+    { NULL }
+};
+
+void CL_InitProf(void)
+{
+    prof.framenum = 1;
+
+    cl_profile = Cvar_Get("cl_profile", "0", 0);
+    cl_profile->changed = cl_profile_changed;
+    cl_profile_changed(cl_profile);
+
+    Cmd_Register(c_prof);
+}
@@ -639,11 +639,6 @@ static void S_SpatializeOrigin(const vec3_t origin, float master_vol, float dist
     vec_t       lscale, rscale, scale;
     vec3_t      source_vec;
 
-    if (cls.state != ca_active) {
-        *left_vol = *right_vol = 255;
-        return;
-    }
-
 // calculate stereo seperation and distance attenuation
     VectorSubtract(origin, listener_origin, source_vec);
 
@@ -690,7 +685,7 @@ static void S_Spatialize(channel_t *ch)
     vec3_t      origin;
 
     // anything coming from the view entity will always be full volume
-    if (ch->entnum == -1 || ch->entnum == listener_entnum) {
+    if (cls.state != ca_active || ch->entnum == -1 || ch->entnum == listener_entnum) {
         ch->leftvol = ch->master_vol * 255;
         ch->rightvol = ch->master_vol * 255;
         return;
@@ -965,11 +960,16 @@ void S_StopAllSounds(void)
 // Update sound buffer
 // =======================================================================
 
+// distance beyond which looped sounds are attenuated to silence,
+// both by S_SpatializeOrigin and by the OpenAL distance model
+#define LOOP_CULL_DIST  (SOUND_FULLVOLUME + 1 / SOUND_LOOPATTENUATE + 1)
+
 void S_BuildSoundList(int *sounds)
 {
     int         i;
     int         num;
     entity_state_t  *ent;
+    vec3_t      origin, v;
 
     for (i = 0; i < cl.frame.numEntities; i++) {
         num = (cl.frame.firstEntity + i) & PARSE_ENTITIES_MASK;
@@ -981,11 +981,57 @@ void S_BuildSoundList(int *sounds)
         } else {
             sounds[i] = ent->sound;
         }
+
+        // drop inaudible emitters before anything is spatialized
+        if (sounds[i]) {
+            CL_GetEntitySoundOrigin(ent->number, origin);
+            VectorSubtract(origin, listener_origin, v);
+            if (DotProduct(v, v) > LOOP_CULL_DIST * LOOP_CULL_DIST)
+                sounds[i] = 0;
+        }
     }
 }
 
 #if USE_SNDDMA
 
+/*
+==================
+S_SumLoopSounds
+
+Finds the total contribution of all sounds of each type in one pass,
+remembering the order in which sound types were first seen
+==================
+*/
+static int S_SumLoopSounds(const int *sounds, const vec3_t *origins, int count,
+                           int *left_total, int *right_total, byte *order)
+{
+    int         i, j;
+    int         left, right;
+    int         numorder;
+    byte        seen[MAX_SOUNDS];
+
+    memset(seen, 0, sizeof(seen));
+    numorder = 0;
+
+    for (i = 0; i < count; i++) {
+        j = sounds[i];
+        if (!j)
+            continue;
+
+        if (!seen[j]) {
+            seen[j] = 1;
+            left_total[j] = right_total[j] = 0;
+            order[numorder++] = j;
+        }
+
+        S_SpatializeOrigin(origins[i], 1.0, SOUND_LOOPATTENUATE, &left, &right);
+        left_total[j] += left;
+        right_total[j] += right;
+    }
+
+    return numorder;
+}
+
 /*
 ==================
 S_AddLoopSounds
@@ -999,13 +1045,16 @@ static void S_AddLoopSounds(void)
 {
     int         i, j;
     int         sounds[MAX_EDICTS];
-    int         left, right, left_total, right_total;
+    vec3_t      origins[MAX_EDICTS];
+    int         left_total[MAX_SOUNDS], right_total[MAX_SOUNDS];
+    sfx_t       *sfxs[MAX_SOUNDS];
+    byte        order[MAX_SOUNDS];
+    int         numorder;
     channel_t   *ch;
     sfx_t       *sfx;
     sfxcache_t  *sc;
     int         num;
     entity_state_t  *ent;
-    vec3_t      origin;
 
     if (cls.state != ca_active || !s_active || sv_paused->integer || !s_ambient->integer) {
         return;
@@ -1013,40 +1062,39 @@ static void S_AddLoopSounds(void)
 
     S_BuildSoundList(sounds);
 
+    memset(sfxs, 0, sizeof(sfxs));
+
     for (i = 0; i < cl.frame.numEntities; i++) {
-        if (!sounds[i])
+        j = sounds[i];
+        if (!j)
             continue;
 
-        sfx = S_SfxForHandle(cl.sound_precache[sounds[i]]);
-        if (!sfx)
-            continue;       // bad sound effect
-        sc = sfx->cache;
-        if (!sc)
+        if (!sfxs[j]) {
+            sfx = S_SfxForHandle(cl.sound_precache[j]);
+            if (!sfx || !sfx->cache) {
+                // bad sound effect, don't check this again
+                sfx = (sfx_t *)-1;
+            }
+            sfxs[j] = sfx;
+        }
+
+        if (sfxs[j] == (sfx_t *)-1) {
+            sounds[i] = 0;
             continue;
+        }
 
         num = (cl.frame.firstEntity + i) & PARSE_ENTITIES_MASK;
         ent = &cl.entityStates[num];
+        CL_GetEntitySoundOrigin(ent->number, origins[i]);
+    }
 
-        // find the total contribution of all sounds of this type
-        CL_GetEntitySoundOrigin(ent->number, origin);
-        S_SpatializeOrigin(origin, 1.0, SOUND_LOOPATTENUATE,
-                           &left_total, &right_total);
-        for (j = i + 1; j < cl.frame.numEntities; j++) {
-            if (sounds[j] != sounds[i])
-                continue;
-            sounds[j] = 0;  // don't check this again later
-
-            num = (cl.frame.firstEntity + j) & PARSE_ENTITIES_MASK;
-            ent = &cl.entityStates[num];
+    numorder = S_SumLoopSounds(sounds, (const vec3_t *)origins, cl.frame.numEntities,
+                               left_total, right_total, order);
 
-            CL_GetEntitySoundOrigin(ent->number, origin);
-            S_SpatializeOrigin(origin, 1.0, SOUND_LOOPATTENUATE,
-                               &left, &right);
-            left_total += left;
-            right_total += right;
-        }
+    for (i = 0; i < numorder; i++) {
+        j = order[i];
 
-        if (left_total == 0 && right_total == 0)
+        if (left_total[j] == 0 && right_total[j] == 0)
             continue;       // not audible
 
         // allocate a channel
@@ -1054,12 +1102,11 @@ static void S_AddLoopSounds(void)
         if (!ch)
             return;
 
-        if (left_total > 255)
-            left_total = 255;
-        if (right_total > 255)
-            right_total = 255;
-        ch->leftvol = left_total;
-        ch->rightvol = right_total;
+        sfx = sfxs[j];
+        sc = sfx->cache;
+
+        ch->leftvol = min(left_total[j], 255);
+        ch->rightvol = min(right_total[j], 255);
         ch->autosound = qtrue;  // remove next frame
         ch->sfx = sfx;
         ch->pos = paintedtime % sc->length;
@@ -1067,6 +1114,100 @@ static void S_AddLoopSounds(void)
     }
 }
 
+// per-type rescan S_SumLoopSounds replaced, spatializing every
+// emitter of a type again for each entity that is visited first
+static int S_SumLoopSoundsRef(int *sounds, const vec3_t *origins, int count,
+                              int *left_total, int *right_total, byte *order)
+{
+    int         i, j;
+    int         left, right;
+    int         numorder;
+
+    numorder = 0;
+
+    for (i = 0; i < count; i++) {
+        if (!sounds[i])
+            continue;
+
+        S_SpatializeOrigin(origins[i], 1.0, SOUND_LOOPATTENUATE, &left_total[sounds[i]], &right_total[sounds[i]]);
+
+        for (j = i + 1; j < count; j++) {
+            if (sounds[j] != sounds[i])
+                continue;
+            sounds[j] = 0;  // don't check this again later
+
+            S_SpatializeOrigin(origins[j], 1.0, SOUND_LOOPATTENUATE, &left, &right);
+            left_total[sounds[i]] += left;
+            right_total[sounds[i]] += right;
+        }
+
+        order[numorder++] = sounds[i];
+    }
+
+    return numorder;
+}
+
+/*
+==================
+S_TestLoopSounds
+
+Sums looped sounds of count emitters spread over types sounds around the
+listener with S_SumLoopSounds and S_SumLoopSoundsRef for the given number
+of frames. Returns the number of mismatching sound types, or -1 if sound
+is not initialized.
+==================
+*/
+int S_TestLoopSounds(int count, int types, int frames, unsigned *msec, unsigned *ref_msec)
+{
+    int         sounds[MAX_EDICTS], ref_sounds[MAX_EDICTS];
+    vec3_t      origins[MAX_EDICTS];
+    int         left_total[MAX_SOUNDS], right_total[MAX_SOUNDS];
+    int         ref_left[MAX_SOUNDS], ref_right[MAX_SOUNDS];
+    byte        order[MAX_SOUNDS], ref_order[MAX_SOUNDS];
+    int         i, j, numorder, ref_numorder, errors;
+    unsigned    start;
+
+    if (!s_swapstereo)
+        return -1;
+
+    clamp(count, 1, MAX_EDICTS);
+    clamp(types, 1, MAX_SOUNDS - 1);
+    clamp(frames, 1, 1000000);
+
+    // emitters within twice the cull distance around the listener
+    for (i = 0; i < count; i++) {
+        sounds[i] = 1 + rand() % types;
+        for (j = 0; j < 3; j++)
+            origins[i][j] = listener_origin[j] + (rand() % 1024 - 512) * (LOOP_CULL_DIST / 256);
+    }
+
+    start = Sys_Milliseconds();
+    for (i = 0; i < frames; i++)
+        numorder = S_SumLoopSounds(sounds, (const vec3_t *)origins, count,
+                                   left_total, right_total, order);
+    *msec = Sys_Milliseconds() - start;
+
+    start = Sys_Milliseconds();
+    for (i = 0; i < frames; i++) {
+        memcpy(ref_sounds, sounds, count * sizeof(sounds[0]));
+        ref_numorder = S_SumLoopSoundsRef(ref_sounds, (const vec3_t *)origins, count,
+                                          ref_left, ref_right, ref_order);
+    }
+    *ref_msec = Sys_Milliseconds() - start;
+
+    if (numorder != ref_numorder)
+        return abs(numorder - ref_numorder);
+
+    errors = 0;
+    for (i = 0; i < numorder; i++) {
+        j = order[i];
+        if (j != ref_order[i] || left_total[j] != ref_left[j] || right_total[j] != ref_right[j])
+            errors++;
+    }
+
+    return errors;
+}
+
 #endif
 
 /*
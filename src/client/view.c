@@ -386,7 +386,9 @@ void V_RenderView(void)
         // build a refresh entity list and calc cl.sim*
         // this also calls CL_CalcViewValues which loads
         // v_forward, etc.
+        CL_PROF_START(CL_PROF_ENTITIES);
         CL_AddEntities();
+        CL_PROF_STOP(CL_PROF_ENTITIES);
 
 #ifdef _DEBUG
         if (cl_testparticles->integer)
@@ -30,6 +30,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/utils.h"
 #include "common/mdfour.h"
 #include "system/hunk.h"
+#include "system/system.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 extern mtexinfo_t nulltexinfo;
 
@@ -43,14 +48,33 @@ static cvar_t *map_visibility_patch;
 ===============================================================================
 */
 
+// lump loaders may run on worker threads, so they can't print or allocate
+// from the hunk directly. first message is printed by BSP_LoadLumps.
+typedef struct {
+    void        *lock;      // guards the hunk
+    const char  *func;
+    const char  *msg;
+} lumpload_t;
+
+static void *BSP_LumpAlloc(bsp_t *bsp, lumpload_t *ctx, size_t size)
+{
+    void *buf;
+
+    Sys_LockMutex(ctx->lock);
+    buf = Hunk_Alloc(&bsp->hunk, size);
+    Sys_UnlockMutex(ctx->lock);
+
+    return buf;
+}
+
 #define ALLOC(size) \
-    Hunk_Alloc(&bsp->hunk, size)
+    BSP_LumpAlloc(bsp, ctx, size)
 
 #define LOAD(func) \
-    static qerror_t BSP_Load##func(bsp_t *bsp, void *base, size_t count)
+    static qerror_t BSP_Load##func(bsp_t *bsp, void *base, size_t count, lumpload_t *ctx)
 
-#define DEBUG(msg) \
-    Com_DPrintf("%s: %s\n", __func__, msg)
+#define DEBUG(text) \
+    (ctx->func = __func__, ctx->msg = text)
 
 LOAD(Visibility)
 {
@@ -753,49 +777,284 @@ LOAD(EntString)
 */
 
 typedef struct {
-    qerror_t (*load)(bsp_t *, void *, size_t);
+    qerror_t (*load)(bsp_t *, void *, size_t, lumpload_t *);
     unsigned lump;
+    unsigned deps;      // lumps that must be loaded first
     size_t disksize;
     size_t memsize;
     size_t maxcount;
 } lump_info_t;
 
-#define L(func, lump, disk_t, mem_t) \
-    { BSP_Load##func, LUMP_##lump, sizeof(disk_t), sizeof(mem_t), MAX_MAP_##lump }
+#define L(func, lump, disk_t, mem_t, deps) \
+    { BSP_Load##func, LUMP_##lump, deps, sizeof(disk_t), sizeof(mem_t), MAX_MAP_##lump }
+
+#define D(lump) (1U << LUMP_##lump)
+
+#if USE_REF
+#define R(lump) D(lump)
+#else
+#define R(lump) 0
+#endif
 
+// listed in dependency order, serial loading just walks the table
 static const lump_info_t bsp_lumps[] = {
-    L(Visibility,   VISIBILITY,     byte,           byte),
-    L(Texinfo,      TEXINFO,        dtexinfo_t,     mtexinfo_t),
-    L(Planes,       PLANES,         dplane_t,       cplane_t),
-    L(BrushSides,   BRUSHSIDES,     dbrushside_t,   mbrushside_t),
-    L(Brushes,      BRUSHES,        dbrush_t,       mbrush_t),
-    L(LeafBrushes,  LEAFBRUSHES,    uint16_t,       mbrush_t *),
-    L(AreaPortals,  AREAPORTALS,    dareaportal_t,  mareaportal_t),
-    L(Areas,        AREAS,          darea_t,        marea_t),
+    L(Visibility,   VISIBILITY,     byte,           byte,           0),
+    L(Texinfo,      TEXINFO,        dtexinfo_t,     mtexinfo_t,     0),
+    L(Planes,       PLANES,         dplane_t,       cplane_t,       0),
+    L(BrushSides,   BRUSHSIDES,     dbrushside_t,   mbrushside_t,   D(PLANES) | D(TEXINFO)),
+    L(Brushes,      BRUSHES,        dbrush_t,       mbrush_t,       D(BRUSHSIDES)),
+    L(LeafBrushes,  LEAFBRUSHES,    uint16_t,       mbrush_t *,     D(BRUSHES)),
+    L(AreaPortals,  AREAPORTALS,    dareaportal_t,  mareaportal_t,  0),
+    L(Areas,        AREAS,          darea_t,        marea_t,        D(AREAPORTALS)),
 #if USE_REF
-    L(Lightmap,     LIGHTING,       byte,           byte),
-    L(Vertices,     VERTEXES,       dvertex_t,      mvertex_t),
-    L(Edges,        EDGES,          dedge_t,        medge_t),
-    L(SurfEdges,    SURFEDGES,      uint32_t,       msurfedge_t),
-    L(Faces,        FACES,          dface_t,        mface_t),
-    L(LeafFaces,    LEAFFACES,      uint16_t,       mface_t *),
+    L(Lightmap,     LIGHTING,       byte,           byte,           0),
+    L(Vertices,     VERTEXES,       dvertex_t,      mvertex_t,      0),
+    L(Edges,        EDGES,          dedge_t,        medge_t,        D(VERTEXES)),
+    L(SurfEdges,    SURFEDGES,      uint32_t,       msurfedge_t,    D(EDGES)),
+    L(Faces,        FACES,          dface_t,        mface_t,        D(SURFEDGES) | D(PLANES) | D(TEXINFO) | D(LIGHTING)),
+    L(LeafFaces,    LEAFFACES,      uint16_t,       mface_t *,      D(FACES)),
 #endif
-    L(Leafs,        LEAFS,          dleaf_t,        mleaf_t),
-    L(Nodes,        NODES,          dnode_t,        mnode_t),
-    L(Submodels,    MODELS,         dmodel_t,       mmodel_t),
-    L(EntString,    ENTSTRING,      char,           char),
+    L(Leafs,        LEAFS,          dleaf_t,        mleaf_t,        D(VISIBILITY) | D(AREAS) | D(LEAFBRUSHES) | R(LEAFFACES)),
+    L(Nodes,        NODES,          dnode_t,        mnode_t,        D(PLANES) | D(LEAFS) | R(FACES)),
+    L(Submodels,    MODELS,         dmodel_t,       mmodel_t,       D(LEAFS) | D(NODES) | R(FACES)),
+    L(EntString,    ENTSTRING,      char,           char,           0),
     { NULL }
 };
 
 #undef L
+#undef D
+#undef R
+
+#define NUM_LUMP_INFOS  (q_countof(bsp_lumps) - 1)
+
+#undef DEBUG
+#define DEBUG(msg) \
+    Com_DPrintf("%s: %s\n", __func__, msg)
+
+/*
+==============================================================================
+
+PARALLEL LOADING
+
+Lumps are loaded by a small pool of threads, the calling thread included.
+Each thread picks the first lump in the table whose dependencies are done,
+or computes the checksum if nobody has started it yet. The checksum covers
+the entire file and is usually the longest task, so it goes first.
+
+A map can also be preloaded ahead of time: then all workers are spawned up
+front. Once they are done, BSP_PollPreload joins them from the main loop and
+releases the file. The finished map waits in the cache until BSP_Load asks
+for it, and is dropped if the file has changed by then.
+
+==============================================================================
+*/
+
+#define MAX_LOAD_THREADS    8
+
+typedef struct bspload_s bspload_t;
+
+typedef struct {
+    bspload_t   *load;
+    int         self;
+} bspworker_t;
+
+struct bspload_s {
+    bsp_t       *bsp;
+    const byte  *buf;
+    void        *map;
+    size_t      filelen;
+    void        *lumpdata[HEADER_LUMPS];
+    size_t      lumpcount[HEADER_LUMPS];
+
+    void        *lock;
+    void        *wakeup[MAX_LOAD_THREADS + 1];
+    int         numthreads;
+    bspworker_t workers[MAX_LOAD_THREADS];
+    void        *threads[MAX_LOAD_THREADS];
+
+    // guarded by lock
+    unsigned    started;    // bsp_lumps indices
+    unsigned    loaded;     // LUMP_* bits
+    qboolean    checksummed;
+    int         running;    // worker threads still loading
+    qerror_t    ret;
+    lumpload_t  ctx[NUM_LUMP_INFOS];
+    int         failed;     // bsp_lumps index of the first failure
+};
+
+static cvar_t *map_load_threads;
+
+// must be called with lock held
+static int BSP_NextTask(bspload_t *load)
+{
+    const lump_info_t *info;
+    int i;
+
+    if (!load->checksummed) {
+        load->checksummed = qtrue;
+        return NUM_LUMP_INFOS;
+    }
+
+    for (i = 0, info = bsp_lumps; i < NUM_LUMP_INFOS; i++, info++) {
+        if (load->started & (1U << i))
+            continue;
+        if ((load->loaded & info->deps) != info->deps)
+            continue;
+        load->started |= 1U << i;
+        return i;
+    }
+
+    return -1;
+}
+
+static void BSP_LoadTasks(bspload_t *load, int self)
+{
+    const lump_info_t *info;
+    unsigned checksum = 0;
+    qerror_t ret;
+    int i, task;
+
+    Sys_LockMutex(load->lock);
+    while (!load->ret && load->started != (1U << NUM_LUMP_INFOS) - 1) {
+        task = BSP_NextTask(load);
+        if (task < 0) {
+            // everything left depends on lumps still being loaded
+            Sys_WaitCond(load->wakeup[self], load->lock);
+            continue;
+        }
+
+        Sys_UnlockMutex(load->lock);
+
+        if (task == NUM_LUMP_INFOS) {
+            checksum = LittleLong(Com_BlockChecksum((void *)load->buf, load->filelen));
+            ret = Q_ERR_SUCCESS;
+        } else {
+            info = &bsp_lumps[task];
+            ret = info->load(load->bsp, load->lumpdata[info->lump],
+                             load->lumpcount[info->lump], &load->ctx[task]);
+        }
+
+        Sys_LockMutex(load->lock);
+
+        if (task == NUM_LUMP_INFOS) {
+            load->bsp->checksum = checksum;
+        } else if (ret) {
+            if (!load->ret) {
+                load->ret = ret;
+                load->failed = task;
+            }
+        } else {
+            load->loaded |= 1U << bsp_lumps[task].lump;
+        }
+
+        // let everyone recheck what became ready
+        for (i = 0; i < load->numthreads; i++) {
+            if (i != self) {
+                Sys_SignalCond(load->wakeup[i]);
+            }
+        }
+    }
+    Sys_UnlockMutex(load->lock);
+}
+
+static void BSP_LoadThread(void *arg)
+{
+    bspworker_t *w = arg;
+    bspload_t *load = w->load;
+
+    BSP_LoadTasks(load, w->self);
+
+    Sys_LockMutex(load->lock);
+    load->running--;
+    Sys_UnlockMutex(load->lock);
+}
+
+/*
+==================
+BSP_StartLumps
+
+Spawns count worker threads. The calling thread joins them later in
+BSP_FinishLumps, which is all the work there is when count is zero.
+Threads are created here on the main thread since thread creation goes
+through the zone allocator.
+==================
+*/
+static void BSP_StartLumps(bspload_t *load, int count)
+{
+    int i;
+
+    load->lock = Sys_CreateMutex();
+    load->numthreads = count + 1;
+    for (i = 0; i < load->numthreads; i++) {
+        load->wakeup[i] = Sys_CreateCond();
+    }
+    for (i = 0; i < NUM_LUMP_INFOS; i++) {
+        load->ctx[i].lock = load->lock;
+    }
+
+    // threads that failed to start are simply never waited for, the
+    // remaining ones pick up their share of the work
+    for (i = 0; i < count; i++) {
+        load->workers[i].load = load;
+        load->workers[i].self = i;
+        load->threads[i] = Sys_CreateThread(BSP_LoadThread, &load->workers[i]);
+        if (load->threads[i]) {
+            Sys_LockMutex(load->lock);
+            load->running++;
+            Sys_UnlockMutex(load->lock);
+        }
+    }
+}
+
+static qerror_t BSP_FinishLumps(bspload_t *load)
+{
+    lumpload_t *ctx;
+    int i, count = load->numthreads - 1;
+
+    BSP_LoadTasks(load, count);
+
+    for (i = 0; i < count; i++) {
+        if (load->threads[i]) {
+            Sys_JoinThread(load->threads[i]);
+        }
+    }
+
+    for (i = 0; i < load->numthreads; i++) {
+        Sys_DestroyCond(load->wakeup[i]);
+    }
+    Sys_DestroyMutex(load->lock);
+
+    if (load->ret) {
+        ctx = &load->ctx[load->failed];
+        if (ctx->msg) {
+            Com_DPrintf("%s: %s\n", ctx->func, ctx->msg);
+        }
+    }
+
+    return load->ret;
+}
 
 static list_t   bsp_cache;
 
+// map loaded ahead of time. The map is put in bsp_cache once load finishes,
+// and holds a reference until BSP_Load claims it
+static struct {
+    bspload_t   *load;      // set while workers are running
+    bsp_t       *bsp;
+    ssize_t     filelen;    // file as it was when preloading started
+    file_info_t info;
+} bsp_preload;
+
 static void BSP_List_f(void)
 {
     bsp_t *bsp;
     size_t bytes;
 
+    if (bsp_preload.bsp) {
+        Com_Printf("%s %s\n", bsp_preload.load ? "Preloading" : "Preloaded",
+                   bsp_preload.bsp->name);
+    }
+
     if (LIST_EMPTY(&bsp_cache)) {
         Com_Printf("BSP cache is empty\n");
         return;
@@ -946,57 +1205,51 @@ void BSP_Free(bsp_t *bsp)
 
 /*
 ==================
-BSP_Load
+BSP_OpenLoad
 
-Loads in the map and all submodels
+Maps the file, validates the header and lump extents and reserves the hunk.
 ==================
 */
-qerror_t BSP_Load(const char *name, bsp_t **bsp_p)
+static qerror_t BSP_OpenLoad(const char *name, bspload_t *load)
 {
     bsp_t           *bsp;
-    byte            *buf;
+    const byte      *buf;
+    void            *map;
     dheader_t       *header;
     const lump_info_t *info;
     size_t          filelen, ofs, len, end, count;
     qerror_t        ret;
-    byte            *lumpdata[HEADER_LUMPS];
-    size_t          lumpcount[HEADER_LUMPS];
     size_t          memsize;
 
-    if (!name || !bsp_p)
-        Com_Error(ERR_FATAL, "%s: NULL", __func__);
-
-    *bsp_p = NULL;
-
-    if (!*name)
-        return Q_ERR_NOENT;
-
-    if ((bsp = BSP_Find(name)) != NULL) {
-        Com_PageInMemory(bsp->hunk.base, bsp->hunk.cursize);
-        bsp->refcount++;
-        *bsp_p = bsp;
-        return Q_ERR_SUCCESS;
-    }
-
     //
-    // load the file
+    // map the file, lumps are parsed straight out of it
     //
-    filelen = FS_LoadFile(name, (void **)&buf);
+    filelen = FS_MapFile(name, (const void **)&buf, &map);
     if (!buf) {
         return filelen;
     }
 
+    if (filelen < sizeof(*header)) {
+        ret = Q_ERR_FILE_TOO_SMALL;
+        goto fail;
+    }
+
     // byte swap and validate the header
     header = (dheader_t *)buf;
     if (LittleLong(header->ident) != IDBSPHEADER) {
         ret = Q_ERR_UNKNOWN_FORMAT;
-        goto fail2;
+        goto fail;
     }
     if (LittleLong(header->version) != BSPVERSION) {
         ret = Q_ERR_UNKNOWN_FORMAT;
-        goto fail2;
+        goto fail;
     }
 
+    memset(load, 0, sizeof(*load));
+    load->buf = buf;
+    load->map = map;
+    load->filelen = filelen;
+
     // byte swap and validate all lumps
     memsize = 0;
     for (info = bsp_lumps; info->load; info++) {
@@ -1005,20 +1258,21 @@ qerror_t BSP_Load(const char *name, bsp_t **bsp_p)
         end = ofs + len;
         if (end < ofs || end > filelen) {
             ret = Q_ERR_BAD_EXTENT;
-            goto fail2;
+            goto fail;
         }
         if (len % info->disksize) {
             ret = Q_ERR_ODD_SIZE;
-            goto fail2;
+            goto fail;
         }
         count = len / info->disksize;
         if (count > info->maxcount) {
             ret = Q_ERR_TOO_MANY;
-            goto fail2;
+            goto fail;
         }
 
-        lumpdata[info->lump] = buf + ofs;
-        lumpcount[info->lump] = count;
+        // loaders only read lump data
+        load->lumpdata[info->lump] = (void *)(buf + ofs);
+        load->lumpcount[info->lump] = count;
 
         memsize += count * info->memsize;
     }
@@ -1032,41 +1286,249 @@ qerror_t BSP_Load(const char *name, bsp_t **bsp_p)
     // add an extra page for cacheline alignment overhead
     Hunk_Begin(&bsp->hunk, memsize + 4096);
 
-    // calculate the checksum
-    bsp->checksum = LittleLong(Com_BlockChecksum(buf, filelen));
+    load->bsp = bsp;
+    return Q_ERR_SUCCESS;
 
-    // load all lumps
-    for (info = bsp_lumps; info->load; info++) {
-        ret = info->load(bsp, lumpdata[info->lump], lumpcount[info->lump]);
-        if (ret) {
-            goto fail1;
-        }
+fail:
+    FS_UnmapFile(map);
+    return ret;
+}
+
+/*
+==================
+BSP_CloseLoad
+
+Waits for the lumps to finish loading, then validates and caches the map.
+On failure load->bsp is freed and cleared.
+==================
+*/
+static qerror_t BSP_CloseLoad(bspload_t *load)
+{
+    bsp_t       *bsp = load->bsp;
+    qerror_t    ret;
+
+    ret = BSP_FinishLumps(load);
+    if (ret) {
+        goto fail;
     }
 
     ret = BSP_ValidateAreaPortals(bsp);
     if (ret) {
-        goto fail1;
+        goto fail;
     }
 
     ret = BSP_ValidateTree(bsp);
     if (ret) {
-        goto fail1;
+        goto fail;
     }
 
     Hunk_End(&bsp->hunk);
 
     List_Append(&bsp_cache, &bsp->entry);
 
-    FS_FreeFile(buf);
-
-    *bsp_p = bsp;
+    FS_UnmapFile(load->map);
     return Q_ERR_SUCCESS;
 
-fail1:
+fail:
     Hunk_Free(&bsp->hunk);
     Z_Free(bsp);
-fail2:
-    FS_FreeFile(buf);
+    load->bsp = NULL;
+    FS_UnmapFile(load->map);
+    return ret;
+}
+
+// length and on-disk info of the file (or its pack) the map comes from
+static qboolean BSP_StatFile(const char *name, ssize_t *len, file_info_t *info)
+{
+    qhandle_t f;
+    qerror_t ret;
+
+    *len = FS_FOpenFile(name, &f, FS_MODE_READ);
+    if (!f) {
+        return qfalse;
+    }
+
+    ret = FS_GetFileInfo(f, info);
+    FS_FCloseFile(f);
+    return !ret;
+}
+
+// joins the workers and caches the map, errors are reported by the
+// normal load that follows
+static void BSP_FinishPreload(void)
+{
+    bspload_t *load = bsp_preload.load;
+
+    bsp_preload.load = NULL;
+    if (BSP_CloseLoad(load)) {
+        bsp_preload.bsp = NULL;
+    }
+    Z_Free(load);
+}
+
+static void BSP_DropPreload(void)
+{
+    // there is no way to interrupt the loaders, help them finish
+    if (bsp_preload.load) {
+        BSP_FinishPreload();
+    }
+    BSP_Free(bsp_preload.bsp);
+    bsp_preload.bsp = NULL;
+}
+
+/*
+==================
+BSP_PollPreload
+
+Called every frame. Once the preload workers are done, joins them and
+releases the file, so that it isn't kept open for the rest of the level.
+==================
+*/
+void BSP_PollPreload(void)
+{
+    bspload_t   *load = bsp_preload.load;
+    qboolean    done;
+
+    if (!load) {
+        return;
+    }
+
+    Sys_LockMutex(load->lock);
+    done = !load->running;
+    Sys_UnlockMutex(load->lock);
+
+    if (done) {
+        BSP_FinishPreload();
+    }
+}
+
+/*
+==================
+BSP_Preload
+
+Starts loading the map in background threads, so that a following BSP_Load
+of the same name only has to wait for whatever is left. Maps already in the
+cache are left alone. Only one map is preloaded at a time, starting another
+one (or passing NULL) drops the pending one. Only errors opening the file
+are returned, the rest are reported when the map is actually loaded.
+==================
+*/
+qerror_t BSP_Preload(const char *name)
+{
+    bspload_t   *load;
+    qerror_t    ret;
+    int         numthreads;
+
+    if (name && BSP_Find(name)) {
+        return Q_ERR_SUCCESS;
+    }
+
+    if (bsp_preload.bsp) {
+        if (name && !FS_pathcmp(bsp_preload.bsp->name, name)) {
+            return Q_ERR_SUCCESS;
+        }
+        BSP_DropPreload();
+    }
+
+    if (!name || !*name) {
+        return Q_ERR_SUCCESS;
+    }
+
+    if (!BSP_StatFile(name, &bsp_preload.filelen, &bsp_preload.info)) {
+        return bsp_preload.filelen < 0 ? bsp_preload.filelen : Q_ERR_NOSYS;
+    }
+
+    load = Z_Malloc(sizeof(*load));
+    ret = BSP_OpenLoad(name, load);
+    if (ret) {
+        Z_Free(load);
+        return ret;
+    }
+
+    numthreads = Cvar_ClampInteger(map_load_threads, 1, MAX_LOAD_THREADS);
+    BSP_StartLumps(load, numthreads);
+    bsp_preload.load = load;
+    bsp_preload.bsp = load->bsp;
+    return Q_ERR_SUCCESS;
+}
+
+// takes over the preload reference, unless the file changed since
+static bsp_t *BSP_ClaimPreload(void)
+{
+    bsp_t       *bsp;
+    file_info_t info;
+    ssize_t     filelen;
+
+    if (bsp_preload.load) {
+        BSP_FinishPreload();
+    }
+
+    bsp = bsp_preload.bsp;
+    bsp_preload.bsp = NULL;
+    if (!bsp) {
+        return NULL;
+    }
+
+    if (!BSP_StatFile(bsp->name, &filelen, &info)
+        || filelen != bsp_preload.filelen
+        || info.size != bsp_preload.info.size
+        || info.mtime != bsp_preload.info.mtime) {
+        Com_DPrintf("%s: %s changed since preloading\n", __func__, bsp->name);
+        BSP_Free(bsp);
+        return NULL;
+    }
+
+    Com_PageInMemory(bsp->hunk.base, bsp->hunk.cursize);
+    return bsp;
+}
+
+/*
+==================
+BSP_Load
+
+Loads in the map and all submodels
+==================
+*/
+qerror_t BSP_Load(const char *name, bsp_t **bsp_p)
+{
+    bsp_t           *bsp;
+    bspload_t       load;
+    qerror_t        ret;
+    int             numthreads;
+
+    if (!name || !bsp_p)
+        Com_Error(ERR_FATAL, "%s: NULL", __func__);
+
+    *bsp_p = NULL;
+
+    if (!*name)
+        return Q_ERR_NOENT;
+
+    if (bsp_preload.bsp && !FS_pathcmp(bsp_preload.bsp->name, name)) {
+        if ((bsp = BSP_ClaimPreload()) != NULL) {
+            *bsp_p = bsp;
+            return Q_ERR_SUCCESS;
+        }
+    }
+
+    if ((bsp = BSP_Find(name)) != NULL) {
+        Com_PageInMemory(bsp->hunk.base, bsp->hunk.cursize);
+        bsp->refcount++;
+        *bsp_p = bsp;
+        return Q_ERR_SUCCESS;
+    }
+
+    ret = BSP_OpenLoad(name, &load);
+    if (ret) {
+        return ret;
+    }
+
+    // load all lumps and calculate the checksum
+    numthreads = Cvar_ClampInteger(map_load_threads, 1, MAX_LOAD_THREADS);
+    BSP_StartLumps(&load, numthreads - 1);
+
+    ret = BSP_CloseLoad(&load);
+    *bsp_p = load.bsp;
     return ret;
 }
 
@@ -1270,6 +1732,130 @@ overrun:
     return mask;
 }
 
+/*
+==============================================================================
+
+VIS ROWS
+
+Whole row operations on decompressed PVS/PHS rows. Sizes are in bytes,
+normally bsp->visrowsize. Rows are processed 16 bytes at a time with SSE2
+where available, 8 bytes at a time otherwise. Tails are handled exactly,
+so nothing past size is read or written.
+
+==============================================================================
+*/
+
+static inline uint64_t vis_load(const byte *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void vis_store(byte *p, uint64_t v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline int vis_popcount(uint64_t v)
+{
+#ifdef __GNUC__
+    return __builtin_popcountll(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (v * 0x0101010101010101ULL) >> 56;
+#endif
+}
+
+void BSP_VisOr(byte *dst, const byte *src, int size)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    for (; i + 16 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(a, b));
+    }
+#endif
+    for (; i + 8 <= size; i += 8)
+        vis_store(dst + i, vis_load(dst + i) | vis_load(src + i));
+    for (; i < size; i++)
+        dst[i] |= src[i];
+}
+
+void BSP_VisAnd(byte *dst, const byte *src, int size)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    for (; i + 16 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(a, b));
+    }
+#endif
+    for (; i + 8 <= size; i += 8)
+        vis_store(dst + i, vis_load(dst + i) & vis_load(src + i));
+    for (; i < size; i++)
+        dst[i] &= src[i];
+}
+
+// returns number of set bits
+int BSP_VisCount(const byte *row, int size)
+{
+    int i = 0, count = 0;
+
+    for (; i + 8 <= size; i += 8)
+        count += vis_popcount(vis_load(row + i));
+    for (; i < size; i++)
+        count += vis_popcount(row[i]);
+
+    return count;
+}
+
+/*
+==================
+BSP_VisBits
+
+Writes indices of all set bits into bits, which must hold size * 8 values,
+and returns their number. Runs of empty bytes are skipped a block at a time.
+==================
+*/
+int BSP_VisBits(const byte *row, int size, int *bits)
+{
+    int i = 0, k, end, count = 0;
+    unsigned b;
+
+    while (i < size) {
+#ifdef __SSE2__
+        if (i + 16 <= size) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(row + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xffff) {
+                i += 16;
+                continue;
+            }
+        }
+#endif
+        if (i + 8 <= size && !vis_load(row + i)) {
+            i += 8;
+            continue;
+        }
+        // branchless, every index is stored but only kept if its bit is set
+        for (end = min(i + 8, size); i < end; i++) {
+            b = row[i];
+            for (k = 0; k < 8; k++) {
+                bits[count] = (i << 3) + k;
+                count += (b >> k) & 1;
+            }
+        }
+    }
+
+    return count;
+}
+
 mleaf_t *BSP_PointLeaf(mnode_t *node, vec3_t p)
 {
     float d;
@@ -1311,6 +1897,7 @@ mmodel_t *BSP_InlineModel(bsp_t *bsp, const char *name)
 void BSP_Init(void)
 {
     map_visibility_patch = Cvar_Get("map_visibility_patch", "1", 0);
+    map_load_threads = Cvar_Get("map_load_threads", "4", 0);
 
     Cmd_AddCommand("bsplist", BSP_List_f);
 
@@ -1047,8 +1047,7 @@ byte *CM_FatPVS(cm_t *cm, byte *mask, const vec3_t org)
     byte    temp[VIS_MAX_BYTES];
     mleaf_t *leafs[64];
     int     clusters[64];
-    int     i, j, count, longs;
-    uint_fast32_t *src, *dst;
+    int     i, j, count;
     vec3_t  mins, maxs;
 
     if (!cm->cache) {   // map not loaded
@@ -1066,7 +1065,6 @@ byte *CM_FatPVS(cm_t *cm, byte *mask, const vec3_t org)
     count = CM_BoxLeafs(cm, mins, maxs, leafs, 64, NULL);
     if (count < 1)
         Com_Error(ERR_DROP, "CM_FatPVS: leaf count < 1");
-    longs = VIS_FAST_LONGS(cm->cache);
 
     // convert leafs to clusters
     for (i = 0; i < count; i++) {
@@ -1082,11 +1080,8 @@ byte *CM_FatPVS(cm_t *cm, byte *mask, const vec3_t org)
                 goto nextleaf; // already have the cluster we want
             }
         }
-        src = (uint_fast32_t *)BSP_ClusterVis(cm->cache, temp, clusters[i], DVIS_PVS);
-        dst = (uint_fast32_t *)mask;
-        for (j = 0; j < longs; j++) {
-            *dst++ |= *src++;
-        }
+        BSP_ClusterVis(cm->cache, temp, clusters[i], DVIS_PVS);
+        BSP_VisOr(mask, temp, cm->cache->visrowsize);
 
 nextleaf:;
     }
@@ -566,6 +566,7 @@ void Com_Error(error_type_t code, const char *fmt, ...)
     // doesn't get there
 
 abort:
+    FS_AbortRegistration();
     if (com_logFile) {
         FS_Flush(com_logFile);
     }
@@ -1128,6 +1129,9 @@ void Qcommon_Frame(void)
 
     NET_UpdateStats();
 
+    // release the next map once it has been preloaded
+    BSP_PollPreload();
+
     remaining = SV_Frame(msec);
 
 #if USE_CLIENT
@@ -19,6 +19,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "shared/shared.h"
 #include "shared/list.h"
 #include "common/common.h"
+#include "common/bsp.h"
 #include "common/cvar.h"
 #include "common/error.h"
 #include "common/files.h"
@@ -135,6 +136,8 @@ typedef struct searchpath_s {
     char        filename[1];
 } searchpath_t;
 
+typedef struct fs_async_s fs_async_t;
+
 typedef struct {
     filetype_t  type;
     unsigned    mode;
@@ -148,8 +151,14 @@ typedef struct {
     qerror_t    error;      // stream error indicator from read/write operation
     size_t      rest_out;   // remaining unread length for FS_PAK/FS_ZIP
     size_t      length;     // total cached file length
+    fs_async_t  *async;     // writer thread state for FS_FLAG_ASYNC
 } file_t;
 
+typedef struct {
+    void        *map;       // system mapping, NULL if loaded into memory
+    const void  *data;
+} fsmap_t;
+
 typedef struct {
     list_t  entry;
     size_t  targlen;
@@ -175,21 +184,39 @@ static int          fs_count_read;
 static int          fs_count_open;
 static int          fs_count_strcmp;
 static int          fs_count_strlwr;
+static int          fs_count_list;
+static int          fs_count_fallback;
 #define FS_COUNT_READ       fs_count_read++
 #define FS_COUNT_OPEN       fs_count_open++
 #define FS_COUNT_STRCMP     fs_count_strcmp++
 #define FS_COUNT_STRLWR     fs_count_strlwr++
+#define FS_COUNT_LIST       fs_count_list++
+#define FS_COUNT_FALLBACK   fs_count_fallback++
 #else
 #define FS_COUNT_READ       (void)0
 #define FS_COUNT_OPEN       (void)0
 #define FS_COUNT_STRCMP     (void)0
 #define FS_COUNT_STRLWR     (void)0
+#define FS_COUNT_LIST       (void)0
+#define FS_COUNT_FALLBACK   (void)0
 #endif
 
+// backpressure statistics for async writes
+static size_t       fs_async_bytes;
+static size_t       fs_async_maxfill;
+static unsigned     fs_async_stalls;
+static unsigned     fs_async_stallmsec;
+
 #ifdef _DEBUG
 static cvar_t       *fs_debug;
 #endif
 
+#if USE_TESTS
+// lookup trace for fsbench
+static qhandle_t    fs_record_file;
+static char         fs_record_name[MAX_OSPATH];
+#endif
+
 cvar_t              *fs_game;
 
 #if USE_ZLIB
@@ -207,6 +234,9 @@ static ssize_t read_zip_file(file_t *file, void *buf, size_t len);
 static pack_t *pack_get(pack_t *pack);
 static void pack_put(pack_t *pack);
 
+// for dropping cached lookups on writes
+static void index_invalidate(const char *normalized);
+
 /*
 
 All of Quake's data access is through a hierchal file system,
@@ -433,6 +463,232 @@ static file_t *file_for_handle(qhandle_t f)
     return file;
 }
 
+#define FS_ERR_READ(fp) \
+    (ferror(fp) ? Q_Errno() : Q_ERR_UNEXPECTED_EOF)
+#define FS_ERR_WRITE(fp) \
+    (ferror(fp) ? Q_Errno() : Q_ERR_FAILURE)
+
+/*
+==============================================================================
+
+ASYNC WRITES
+
+Files opened for writing with FS_FLAG_ASYNC hand their data to a bounded ring
+buffer that is drained by a dedicated writer thread, which also does gzip
+compression for FS_GZ files. The writer is started on the first write, so
+FS_FilterFile can still be applied after opening. Main thread only blocks
+when the ring is full, or when FS_Flush, FS_Seek or FS_FCloseFile wait for
+it to drain. Write errors are reported by subsequent writes.
+
+==============================================================================
+*/
+
+#define FS_ASYNC_SIZE   0x100000    // must be power of two
+
+struct fs_async_s {
+    void        *thread;
+    void        *lock;
+    void        *wakeup;    // signaled by main thread
+    void        *drained;   // signaled by writer thread
+    byte        *data;
+    size_t      head;       // total bytes submitted, modified by main thread
+    size_t      tail;       // total bytes written out, modified by writer
+    size_t      base;       // file position head is relative to
+    qerror_t    error;      // set by writer thread
+    qboolean    shutdown;
+};
+
+static qerror_t write_file(file_t *file, const void *buf, size_t len)
+{
+    switch (file->type) {
+    case FS_REAL:
+        if (fwrite(buf, 1, len, file->fp) != len) {
+            return FS_ERR_WRITE(file->fp);
+        }
+        break;
+#if USE_ZLIB
+    case FS_GZ:
+        if (gzwrite(file->zfp, buf, len) == 0) {
+            return Q_ERR_LIBRARY_ERROR;
+        }
+        break;
+#endif
+    default:
+        Com_Error(ERR_FATAL, "%s: bad file type", __func__);
+    }
+
+    return Q_ERR_SUCCESS;
+}
+
+static void async_thread(void *arg)
+{
+    file_t *file = arg;
+    fs_async_t *a = file->async;
+    size_t tail, len;
+    qerror_t ret;
+
+    Sys_LockMutex(a->lock);
+    while (1) {
+        while (a->head == a->tail && !a->shutdown) {
+            Sys_WaitCond(a->wakeup, a->lock);
+        }
+        if (a->head == a->tail) {
+            break;
+        }
+
+        tail = a->tail & (FS_ASYNC_SIZE - 1);
+        len = min(a->head - a->tail, FS_ASYNC_SIZE - tail);
+        Sys_UnlockMutex(a->lock);
+
+        // once failed, discard the rest
+        ret = Q_ERR_SUCCESS;
+        if (!a->error) {
+            ret = write_file(file, a->data + tail, len);
+        }
+
+        Sys_LockMutex(a->lock);
+        if (ret) {
+            a->error = ret;
+        }
+        a->tail += len;
+        Sys_SignalCond(a->drained);
+    }
+    Sys_UnlockMutex(a->lock);
+}
+
+static void async_free(file_t *file)
+{
+    fs_async_t *a = file->async;
+
+    Sys_DestroyCond(a->drained);
+    Sys_DestroyCond(a->wakeup);
+    Sys_DestroyMutex(a->lock);
+    Z_Free(a->data);
+    Z_Free(a);
+    file->async = NULL;
+}
+
+static void async_start(file_t *file)
+{
+    fs_async_t *a;
+    long pos;
+
+    switch (file->type) {
+    case FS_REAL:
+        pos = ftell(file->fp);
+        break;
+#if USE_ZLIB
+    case FS_GZ:
+        pos = gztell(file->zfp);
+        break;
+#endif
+    default:
+        pos = -1;
+        break;
+    }
+
+    if (pos == -1 || (file->mode & FS_MODE_MASK) == FS_MODE_RDWR) {
+        file->mode &= ~FS_FLAG_ASYNC;
+        return;
+    }
+
+    a = FS_Mallocz(sizeof(*a));
+    a->data = FS_Malloc(FS_ASYNC_SIZE);
+    a->lock = Sys_CreateMutex();
+    a->wakeup = Sys_CreateCond();
+    a->drained = Sys_CreateCond();
+    a->base = pos;
+    file->async = a;
+
+    a->thread = Sys_CreateThread(async_thread, file);
+    if (!a->thread) {
+        Com_WPrintf("Couldn't start async writer: %s\n", Com_GetLastError());
+        async_free(file);
+        file->mode &= ~FS_FLAG_ASYNC;
+    }
+}
+
+// waits until writer thread is idle
+static void async_drain(file_t *file)
+{
+    fs_async_t *a = file->async;
+
+    Sys_LockMutex(a->lock);
+    while (a->head != a->tail) {
+        Sys_WaitCond(a->drained, a->lock);
+    }
+    if (a->error && !file->error) {
+        file->error = a->error;
+    }
+    Sys_UnlockMutex(a->lock);
+}
+
+static void async_stop(file_t *file)
+{
+    fs_async_t *a = file->async;
+
+    Sys_LockMutex(a->lock);
+    a->shutdown = qtrue;
+    Sys_SignalCond(a->wakeup);
+    Sys_UnlockMutex(a->lock);
+
+    Sys_JoinThread(a->thread);
+
+    if (a->error && !file->error) {
+        file->error = a->error;
+    }
+
+    async_free(file);
+}
+
+static qerror_t async_write(file_t *file, const void *buf, size_t len)
+{
+    fs_async_t *a = file->async;
+    const byte *src = buf;
+    size_t head, space, count, fill;
+    unsigned start = 0;
+    qboolean stalled = qfalse;
+    qerror_t ret;
+
+    Sys_LockMutex(a->lock);
+    while (len && !a->error) {
+        space = FS_ASYNC_SIZE - (a->head - a->tail);
+        if (!space) {
+            if (!stalled) {
+                start = Sys_Milliseconds();
+                stalled = qtrue;
+            }
+            Sys_WaitCond(a->drained, a->lock);
+            continue;
+        }
+
+        // writer never touches the free part of the ring
+        head = a->head & (FS_ASYNC_SIZE - 1);
+        count = min(len, min(space, FS_ASYNC_SIZE - head));
+        Sys_UnlockMutex(a->lock);
+
+        memcpy(a->data + head, src, count);
+        src += count;
+        len -= count;
+
+        Sys_LockMutex(a->lock);
+        a->head += count;
+        Sys_SignalCond(a->wakeup);
+    }
+    fill = a->head - a->tail;
+    ret = a->error;
+    Sys_UnlockMutex(a->lock);
+
+    if (stalled) {
+        fs_async_stalls++;
+        fs_async_stallmsec += Sys_Milliseconds() - start;
+    }
+    fs_async_bytes += src - (const byte *)buf;
+    fs_async_maxfill = max(fs_async_maxfill, fill);
+
+    return ret;
+}
+
 static void cleanup_path(char *s)
 {
     for (; *s; s++) {
@@ -499,6 +755,10 @@ ssize_t FS_Tell(qhandle_t f)
     if (!file)
         return Q_ERR_BADF;
 
+    // head is only modified by main thread
+    if (file->async)
+        return file->async->base + file->async->head;
+
     switch (file->type) {
     case FS_REAL:
         ret = ftell(file->fp);
@@ -563,6 +823,11 @@ qerror_t FS_Seek(qhandle_t f, off_t offset)
     if (offset < 0)
         offset = 0;
 
+    if (file->async) {
+        async_drain(file);
+        file->async->base = offset - file->async->head;
+    }
+
     switch (file->type) {
     case FS_REAL:
         if (fseek(file->fp, (long)offset, SEEK_SET) == -1) {
@@ -634,11 +899,6 @@ qerror_t FS_CreatePath(char *path)
     return Q_ERR_SUCCESS;
 }
 
-#define FS_ERR_READ(fp) \
-    (ferror(fp) ? Q_Errno() : Q_ERR_UNEXPECTED_EOF)
-#define FS_ERR_WRITE(fp) \
-    (ferror(fp) ? Q_Errno() : Q_ERR_FAILURE)
-
 /*
 ============
 FS_FilterFile
@@ -670,6 +930,10 @@ qerror_t FS_FilterFile(qhandle_t f)
         return Q_ERR_NOSYS;
     }
 
+    // writer will be restarted on next write
+    if (file->async)
+        async_stop(file);
+
     mode = file->mode & FS_MODE_MASK;
     switch (mode) {
     case FS_MODE_READ:
@@ -752,6 +1016,9 @@ void FS_FCloseFile(qhandle_t f)
     if (!file)
         return;
 
+    if (file->async)
+        async_stop(file);
+
     switch (file->type) {
     case FS_REAL:
         fclose(file->fp);
@@ -830,6 +1097,27 @@ static qerror_t get_fp_info(FILE *fp, file_info_t *info)
     return Q_ERR_SUCCESS;
 }
 
+/*
+============
+FS_GetFileInfo
+
+Returns size and times of the file on disk a read handle is backed by. For
+files inside packs, this is the pack file itself.
+============
+*/
+qerror_t FS_GetFileInfo(qhandle_t f, file_info_t *info)
+{
+    file_t *file = file_for_handle(f);
+
+    if (!file)
+        return Q_ERR_BADF;
+
+    if ((file->mode & FS_MODE_MASK) != FS_MODE_READ || !file->fp)
+        return Q_ERR_NOSYS;
+
+    return get_fp_info(file->fp, info);
+}
+
 static inline FILE *fopen_hack(const char *path, const char *mode)
 {
 #ifndef _GNU_SOURCE
@@ -997,6 +1285,8 @@ static ssize_t open_file_write(file_t *file, const char *name)
 
     FS_DPrintf("%s: %s: %lu bytes\n", __func__, fullpath, pos);
 
+    index_invalidate(normalized);
+
     file->type = FS_REAL;
     file->fp = fp;
     file->unique = qtrue;
@@ -1270,30 +1560,919 @@ static ssize_t open_from_disk(file_t *file, const char *fullpath)
 
     FS_COUNT_OPEN;
 
-    fp = fopen(fullpath, "rb");
-    if (!fp) {
-        ret = Q_Errno();
-        goto fail;
+    fp = fopen(fullpath, "rb");
+    if (!fp) {
+        ret = Q_Errno();
+        goto fail;
+    }
+
+    ret = get_fp_info(fp, &info);
+    if (ret) {
+        fclose(fp);
+        goto fail;
+    }
+
+    file->type = FS_REAL;
+    file->fp = fp;
+    file->unique = qtrue;
+    file->error = Q_ERR_SUCCESS;
+    file->length = info.size;
+
+    FS_DPrintf("%s: %s: %"PRIz" bytes\n", __func__, fullpath, info.size);
+    return info.size;
+
+fail:
+    FS_DPrintf("%s: %s: %s\n", __func__, fullpath, Q_ErrorString(ret));
+    return ret;
+}
+
+/*
+=============================================================================
+
+NEGATIVE LOOKUP CACHE
+
+Registration probes many paths that don't exist: alternative image formats,
+model specific sexed sounds, player skins. Paths found missing are remembered
+together with the lookup mode bits that affect the search, and any following
+lookup of the same path fails right away.
+
+Loose files may be created by other programs at any time, so lookups that
+can find them are only cached during registration and flushed when it ends.
+Lookups restricted to packs are cached at any time. The cache is also flushed
+whenever something that could make these paths appear changes: search paths,
+symbolic links, or files written through FS or announced with
+FS_InvalidatePath. Real file lookups are never cached.
+
+=============================================================================
+*/
+
+#define FS_MISS_HASH    1024
+#define FS_MISS_MAX     8192    // flushed when full
+
+#define FS_MISS_MODE    (FS_PATH_MASK | FS_TYPE_MASK | FS_FLAG_DEFLATE)
+
+typedef struct fsmiss_s {
+    struct fsmiss_s *hash_next;
+    unsigned        mode;
+    unsigned        hash;
+    size_t          namelen;
+    char            name[1];
+} fsmiss_t;
+
+static struct {
+    fsmiss_t    *hash[FS_MISS_HASH];
+    unsigned    count;
+    unsigned    hits;
+    unsigned    added;
+    unsigned    flushes;
+} fs_miss;
+
+static cvar_t       *fs_negcache;
+
+static int          fs_registering;     // FS_BeginRegistration depth
+
+static void miss_flush(void)
+{
+    fsmiss_t *m, *next;
+    int i;
+
+    if (!fs_miss.count) {
+        return;
+    }
+
+    for (i = 0; i < FS_MISS_HASH; i++) {
+        for (m = fs_miss.hash[i]; m; m = next) {
+            next = m->hash_next;
+            Z_Free(m);
+        }
+        fs_miss.hash[i] = NULL;
+    }
+
+    fs_miss.count = 0;
+    fs_miss.flushes++;
+}
+
+static qboolean miss_cacheable(unsigned mode)
+{
+    if (!fs_negcache->integer) {
+        return qfalse;
+    }
+
+    switch (mode & FS_TYPE_MASK) {
+    case FS_TYPE_PAK:
+        return qtrue;
+    case FS_TYPE_REAL:
+        return qfalse;
+    default:
+        return fs_registering > 0;
+    }
+}
+
+static qboolean miss_find(const char *name, size_t namelen, unsigned mode)
+{
+    fsmiss_t *m;
+    unsigned hash;
+
+    if (!fs_miss.count || !miss_cacheable(mode)) {
+        return qfalse;
+    }
+
+    hash = FS_HashPath(name, 0);
+    mode &= FS_MISS_MODE;
+    for (m = fs_miss.hash[hash & (FS_MISS_HASH - 1)]; m; m = m->hash_next) {
+        if (m->hash == hash && m->mode == mode && m->namelen == namelen &&
+            !FS_pathcmp(m->name, name)) {
+            fs_miss.hits++;
+            return qtrue;
+        }
+    }
+
+    return qfalse;
+}
+
+static void miss_add(const char *name, size_t namelen, unsigned mode)
+{
+    fsmiss_t *m;
+    unsigned hash;
+
+    if (!miss_cacheable(mode)) {
+        return;
+    }
+
+    if (fs_miss.count >= FS_MISS_MAX) {
+        miss_flush();
+    }
+
+    hash = FS_HashPath(name, 0);
+    m = FS_Malloc(sizeof(*m) + namelen);
+    m->mode = mode & FS_MISS_MODE;
+    m->hash = hash;
+    m->namelen = namelen;
+    memcpy(m->name, name, namelen + 1);
+    m->hash_next = fs_miss.hash[hash & (FS_MISS_HASH - 1)];
+    fs_miss.hash[hash & (FS_MISS_HASH - 1)] = m;
+    fs_miss.count++;
+    fs_miss.added++;
+}
+
+static void fs_negcache_changed(cvar_t *self)
+{
+    miss_flush();
+}
+
+/*
+=============================================================================
+
+PATH INDEX
+
+All pack entries of the current search path are merged into a single hash
+table when search paths change. Each indexed path holds a chain of sources
+sorted in search order, so the first source that passes mode filters wins.
+
+Loose files are indexed one directory at a time, the first time a path in
+that directory is looked up. The directory is listed in all loose search
+paths at once, so a missing file costs no syscalls at all and an existing
+one costs a single open. Since files may be added by other programs at any
+time, listings are only made and used between FS_BeginRegistration and
+FS_EndRegistration, and dropped when registration ends. Outside of that
+loose files are searched for as usual. Listings are also dropped whenever
+FS writes into the directory.
+
+Real file lookups (savegames, configs) bypass the index since the game
+library creates those directly.
+
+=============================================================================
+*/
+
+typedef struct fsindex_s {
+    struct fsindex_s    *hash_next; // next path in the same bucket
+    struct fsindex_s    *next;      // next source of the same path
+    searchpath_t        *search;
+    packfile_t          *entry;     // NULL for loose files
+    unsigned            order;      // position of search in the path
+    unsigned            hash;
+    size_t              namelen;
+    char                *name;      // on-disk case for loose files
+} fsindex_t;
+
+typedef struct fsdir_s {
+    struct fsdir_s  *hash_next;
+    qboolean        complete;       // false if listing was truncated
+    unsigned        num_files;
+    fsindex_t       *files;
+    size_t          namelen;
+    char            name[1];
+} fsdir_t;
+
+#define FS_DIR_HASH     256
+
+static struct {
+    fsindex_t   **hash;
+    unsigned    hash_size;
+    fsindex_t   *packfiles;
+    unsigned    num_packfiles;
+    fsdir_t     *dirs[FS_DIR_HASH];
+    unsigned    num_dirs;
+    unsigned    num_loose;
+} fs_idx;
+
+// scratch space for listing directories
+static void         *fs_list_files[MAX_LISTED_FILES];
+static searchpath_t *fs_list_owner[MAX_LISTED_FILES];
+static qboolean     fs_list_lower[MAX_LISTED_FILES];
+
+static cvar_t       *fs_index;
+
+static fsindex_t *index_find(const char *name, size_t namelen, unsigned hash)
+{
+    fsindex_t *e;
+
+    for (e = fs_idx.hash[hash & (fs_idx.hash_size - 1)]; e; e = e->hash_next) {
+        if (e->hash != hash || e->namelen != namelen) {
+            continue;
+        }
+        FS_COUNT_STRCMP;
+        if (!FS_pathcmp(e->name, name)) {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+// keeps sources of the same path sorted in search order
+static void index_insert(fsindex_t *e)
+{
+    fsindex_t **p, *head;
+
+    head = index_find(e->name, e->namelen, e->hash);
+    if (!head) {
+        p = &fs_idx.hash[e->hash & (fs_idx.hash_size - 1)];
+        e->hash_next = *p;
+        e->next = NULL;
+        *p = e;
+        return;
+    }
+
+    if (e->order < head->order) {
+        // new head takes over the bucket link
+        for (p = &fs_idx.hash[e->hash & (fs_idx.hash_size - 1)]; *p != head; p = &(*p)->hash_next)
+            ;
+        e->hash_next = head->hash_next;
+        e->next = head;
+        *p = e;
+        return;
+    }
+
+    for (p = &head->next; *p && (*p)->order <= e->order; p = &(*p)->next)
+        ;
+    e->next = *p;
+    *p = e;
+}
+
+static void index_remove(fsindex_t *e)
+{
+    fsindex_t **p, **q, *head;
+
+    head = index_find(e->name, e->namelen, e->hash);
+    if (!head) {
+        return;
+    }
+
+    if (head == e) {
+        for (p = &fs_idx.hash[e->hash & (fs_idx.hash_size - 1)]; *p != e; p = &(*p)->hash_next)
+            ;
+        if (e->next) {
+            e->next->hash_next = e->hash_next;
+            *p = e->next;
+        } else {
+            *p = e->hash_next;
+        }
+        return;
+    }
+
+    for (q = &head->next; *q; q = &(*q)->next) {
+        if (*q == e) {
+            *q = e->next;
+            return;
+        }
+    }
+}
+
+static void index_free_dir(fsdir_t *dir)
+{
+    unsigned i;
+
+    for (i = 0; i < dir->num_files; i++) {
+        index_remove(&dir->files[i]);
+    }
+
+    fs_idx.num_loose -= dir->num_files;
+    fs_idx.num_dirs--;
+    Z_Free(dir);
+}
+
+static void index_flush_dirs(void)
+{
+    fsdir_t *dir, *next;
+    int i;
+
+    for (i = 0; i < FS_DIR_HASH; i++) {
+        for (dir = fs_idx.dirs[i]; dir; dir = next) {
+            next = dir->hash_next;
+            index_free_dir(dir);
+        }
+        fs_idx.dirs[i] = NULL;
+    }
+}
+
+static void index_free(void)
+{
+    if (!fs_idx.hash) {
+        return;
+    }
+
+    index_flush_dirs();
+
+    Z_Free(fs_idx.hash);
+    Z_Free(fs_idx.packfiles);
+    fs_idx.hash = NULL;
+    fs_idx.hash_size = 0;
+    fs_idx.packfiles = NULL;
+    fs_idx.num_packfiles = 0;
+}
+
+static void index_build(void)
+{
+    searchpath_t *search;
+    pack_t *pack;
+    fsindex_t *e;
+    unsigned i, order, count;
+
+    index_free();
+
+    if (!fs_index->integer) {
+        return;
+    }
+
+    count = 0;
+    for (search = fs_searchpaths; search; search = search->next) {
+        if (search->pack) {
+            count += search->pack->num_files;
+        }
+    }
+
+    fs_idx.hash_size = npot32(count + MAX_LISTED_FILES);
+    fs_idx.hash = FS_Mallocz(sizeof(fs_idx.hash[0]) * fs_idx.hash_size);
+    fs_idx.packfiles = FS_Malloc(sizeof(fs_idx.packfiles[0]) * count);
+    fs_idx.num_packfiles = count;
+
+    // searchpaths are walked in order, so sources simply go to chain tails
+    e = fs_idx.packfiles;
+    for (search = fs_searchpaths, order = 0; search; search = search->next, order++) {
+        if (!(pack = search->pack)) {
+            continue;
+        }
+        for (i = 0; i < pack->num_files; i++, e++) {
+            e->search = search;
+            e->entry = &pack->files[i];
+            e->order = order;
+            e->hash = FS_HashPath(e->entry->name, 0);
+            e->namelen = e->entry->namelen;
+            e->name = e->entry->name;
+            index_insert(e);
+        }
+    }
+}
+
+static unsigned index_dir_hash(const char *name, size_t namelen)
+{
+    return FS_HashPathLen(name, namelen, FS_DIR_HASH);
+}
+
+// listings are keyed on exact case where directories differing only in
+// case are distinct, so a listing never answers for another directory
+static fsdir_t *index_find_dir(const char *name, size_t namelen)
+{
+    fsdir_t *dir;
+
+    for (dir = fs_idx.dirs[index_dir_hash(name, namelen)]; dir; dir = dir->hash_next) {
+        if (dir->namelen != namelen) {
+            continue;
+        }
+#ifdef _WIN32
+        if (!FS_pathcmpn(dir->name, name, namelen)) {
+#else
+        if (!memcmp(dir->name, name, namelen)) {
+#endif
+            return dir;
+        }
+    }
+
+    return NULL;
+}
+
+// lists directory of the given path in all loose search paths
+static fsdir_t *index_list_dir(const char *name, size_t namelen)
+{
+    void **files = fs_list_files;
+    searchpath_t **owner = fs_list_owner;
+    qboolean *lower = fs_list_lower;
+    char path[MAX_OSPATH];
+    searchpath_t *search;
+    fsdir_t *dir;
+    fsindex_t *e;
+    char *s;
+    size_t len, size;
+    unsigned hash, order;
+    int i, j, count;
+
+    count = 0;
+    for (search = fs_searchpaths; search && count < MAX_LISTED_FILES; search = search->next) {
+        if (search->pack) {
+            continue;
+        }
+
+        len = Q_snprintf(path, sizeof(path), "%s/%.*s", search->filename, (int)namelen, name);
+        if (len >= sizeof(path)) {
+            continue;
+        }
+
+        i = count;
+        FS_COUNT_LIST;
+        Sys_ListFiles_r(path, NULL, 0, 0, &count, files, 0);
+        for (j = i; j < count; j++) {
+            owner[j] = search;
+            lower[j] = qfalse;
+        }
+
+#ifndef _WIN32
+        // same retry open_file_read does for mixed case paths
+        if (count == i && FS_ValidatePath(name) == PATH_MIXED_CASE) {
+            FS_COUNT_STRLWR;
+            Q_strlwr(path + strlen(search->filename) + 1);
+            FS_COUNT_LIST;
+            Sys_ListFiles_r(path, NULL, 0, 0, &count, files, 0);
+            for (j = i; j < count; j++) {
+                owner[j] = search;
+                lower[j] = qtrue;
+            }
+        }
+#endif
+    }
+
+    size = 0;
+    for (i = 0; i < count; i++) {
+        size += namelen + 1 + strlen(files[i]) + 1;
+    }
+
+    dir = FS_Malloc(sizeof(*dir) + namelen + sizeof(dir->files[0]) * count + size);
+    dir->complete = count < MAX_LISTED_FILES;
+    dir->num_files = count;
+    dir->files = (fsindex_t *)(dir->name + ((namelen + sizeof(void *)) & ~(sizeof(void *) - 1)));
+    dir->namelen = namelen;
+    memcpy(dir->name, name, namelen);
+    dir->name[namelen] = 0;
+
+    s = (char *)(dir->files + count);
+    for (i = 0, e = dir->files, order = 0, search = fs_searchpaths; i < count; i++, e++) {
+        for (; search != owner[i]; search = search->next)
+            order++;
+        e->search = search;
+        e->entry = NULL;
+        e->order = order;
+        if (namelen) {
+            memcpy(s, name, namelen);
+            if (lower[i]) {
+                s[namelen] = 0;
+                Q_strlwr(s);
+            }
+            s[namelen] = '/';
+            len = namelen + 1;
+        } else {
+            len = 0;
+        }
+        len += Q_strlcpy(s + len, files[i], MAX_OSPATH);
+        e->name = s;
+        e->namelen = len;
+        e->hash = FS_HashPath(s, 0);
+        s += len + 1;
+        if (dir->complete)
+            index_insert(e);
+        Z_Free(files[i]);
+    }
+
+    if (!dir->complete)
+        dir->num_files = 0;
+
+    hash = index_dir_hash(name, namelen);
+    dir->hash_next = fs_idx.dirs[hash];
+    fs_idx.dirs[hash] = dir;
+    fs_idx.num_dirs++;
+    fs_idx.num_loose += dir->num_files;
+
+    return dir;
+}
+
+// returns false if the index can't tell and search path needs to be walked
+static qboolean index_open_file(file_t *file, const char *normalized, size_t namelen,
+                                qboolean unique, ssize_t *ret_p)
+{
+    searchpath_t *search;
+    fsindex_t *e;
+    fsdir_t *dir;
+    const char *p;
+    char fullpath[MAX_OSPATH];
+    size_t dirlen, len;
+    int valid;
+    ssize_t ret;
+
+    valid = PATH_NOT_CHECKED;
+
+    // make sure loose files in this directory are indexed
+    if ((file->mode & FS_TYPE_MASK) != FS_TYPE_PAK
+#if USE_ZLIB
+        && !(file->mode & FS_FLAG_DEFLATE)
+#endif
+       ) {
+        // listings can't be trusted outside of registration
+        if (!fs_registering) {
+            return qfalse;
+        }
+
+        valid = FS_ValidatePath(normalized);
+        if (valid != PATH_INVALID) {
+            p = strrchr(normalized, '/');
+            dirlen = p ? p - normalized : 0;
+
+            // dotfiles are never listed
+            if (normalized[p ? dirlen + 1 : 0] == '.') {
+                return qfalse;
+            }
+
+            dir = index_find_dir(normalized, dirlen);
+            if (!dir) {
+                dir = index_list_dir(normalized, dirlen);
+            }
+            if (!dir->complete) {
+                FS_COUNT_FALLBACK;
+                return qfalse;
+            }
+        }
+    }
+
+    e = index_find(normalized, namelen, FS_HashPath(normalized, 0));
+    for (; e; e = e->next) {
+        search = e->search;
+        if (file->mode & FS_PATH_MASK) {
+            if ((file->mode & search->mode & FS_PATH_MASK) == 0) {
+                continue;
+            }
+        }
+
+        if (e->entry) {
+            if ((file->mode & FS_TYPE_MASK) == FS_TYPE_REAL) {
+                continue;
+            }
+            if (namelen >= MAX_QPATH) {
+                continue;
+            }
+#if USE_ZLIB
+            if ((file->mode & FS_FLAG_DEFLATE) &&
+                (search->pack->type != FS_ZIP || e->entry->compmtd != Z_DEFLATED)) {
+                continue;
+            }
+#endif
+            *ret_p = open_from_pak(file, search->pack, e->entry, unique);
+            return qtrue;
+        }
+
+        if (valid == PATH_NOT_CHECKED || valid == PATH_INVALID) {
+            continue;
+        }
+
+        len = Q_concat(fullpath, sizeof(fullpath), search->filename, "/", e->name, NULL);
+        if (len >= sizeof(fullpath)) {
+            *ret_p = Q_ERR_NAMETOOLONG;
+            return qtrue;
+        }
+
+        // file may be gone since the directory was listed
+        ret = open_from_disk(file, fullpath);
+        if (ret != Q_ERR_NOENT) {
+            *ret_p = ret;
+            return qtrue;
+        }
+    }
+
+    *ret_p = valid ? Q_ERR_NOENT : Q_ERR_INVALID_PATH;
+    FS_DPrintf("%s: %s: %s\n", __func__, normalized, Q_ErrorString(*ret_p));
+    return qtrue;
+}
+
+// drops loose files listing of the directory given path is in
+static void index_invalidate(const char *normalized)
+{
+    const char *p;
+    size_t dirlen;
+    fsdir_t *dir, **back;
+
+    miss_flush();
+
+    if (!fs_idx.hash) {
+        return;
+    }
+
+    p = strrchr(normalized, '/');
+    dirlen = p ? p - normalized : 0;
+
+    // drop listings of the directory in any case
+    back = &fs_idx.dirs[index_dir_hash(normalized, dirlen)];
+    while ((dir = *back) != NULL) {
+        if (dir->namelen == dirlen && !FS_pathcmpn(dir->name, normalized, dirlen)) {
+            *back = dir->hash_next;
+            index_free_dir(dir);
+        } else {
+            back = &dir->hash_next;
+        }
+    }
+}
+
+/*
+================
+FS_InvalidatePath
+
+Should be called after creating files in the game directory by other means
+than FS, so that the directory is listed again on next lookup. NULL path
+drops all directory listings.
+================
+*/
+void FS_InvalidatePath(const char *path)
+{
+    char normalized[MAX_OSPATH];
+
+    if (!path) {
+        miss_flush();
+        index_flush_dirs();
+        return;
+    }
+
+    if (FS_NormalizePathBuffer(normalized, path, sizeof(normalized)) < sizeof(normalized)) {
+        index_invalidate(normalized);
+    }
+}
+
+/*
+=============================================================================
+
+PREFETCH
+
+Registration reads files one after another and decodes each one before
+opening the next. The client queues the files a level is about to register,
+and a thread reads them ahead of time so they are in the OS cache by the
+time registration opens them. Files are located on the main thread. The
+thread only uses stdio on the resulting paths and never touches FS state.
+
+=============================================================================
+*/
+
+typedef struct {
+    char        *path;      // pack or loose file
+    long        offset;
+    size_t      length;     // 0 reads a loose file to the end
+    int         group;      // candidates of the same name, first found wins
+} fsprefetch_t;
+
+static struct {
+    fsprefetch_t    *items;
+    int             count;
+    int             groups;
+    void            *thread;
+    void            *lock;
+    qboolean        stop;   // guarded by lock
+} fs_prefetch;
+
+static void prefetch_add(const char *path, long offset, size_t length)
+{
+    fsprefetch_t *p;
+
+    if (!(fs_prefetch.count & 63)) {
+        fs_prefetch.items = Z_Realloc(fs_prefetch.items,
+                                      sizeof(fs_prefetch.items[0]) * (fs_prefetch.count + 64));
+    }
+
+    p = &fs_prefetch.items[fs_prefetch.count++];
+    p->path = FS_CopyString(path);
+    p->offset = offset;
+    p->length = length;
+    p->group = fs_prefetch.groups;
+}
+
+static qboolean prefetch_stopped(void)
+{
+    qboolean stop;
+
+    Sys_LockMutex(fs_prefetch.lock);
+    stop = fs_prefetch.stop;
+    Sys_UnlockMutex(fs_prefetch.lock);
+
+    return stop;
+}
+
+static void prefetch_thread(void *arg)
+{
+    static byte buffer[0x10000];    // contents are discarded
+    fsprefetch_t *p;
+    FILE *fp;
+    size_t rest, len;
+    int i, done = -1;
+
+    for (i = 0, p = fs_prefetch.items; i < fs_prefetch.count; i++, p++) {
+        if (p->group == done) {
+            continue;
+        }
+        if (prefetch_stopped()) {
+            break;
+        }
+
+        fp = fopen(p->path, "rb");
+        if (!fp) {
+            continue;
+        }
+        done = p->group;
+
+        if (!p->offset || fseek(fp, p->offset, SEEK_SET) != -1) {
+            rest = p->length ? p->length : SIZE_MAX;
+            while (rest) {
+                len = fread(buffer, 1, min(rest, sizeof(buffer)), fp);
+                if (!len) {
+                    break;
+                }
+                rest -= len;
+            }
+        }
+
+        fclose(fp);
+    }
+}
+
+/*
+================
+FS_PrefetchFile
+
+Queues a file for FS_StartPrefetch. Loose files are listed in all search
+paths up to the first pack that has the file, since checking which of them
+exists would cost the very syscalls prefetching is meant to hide.
+================
+*/
+void FS_PrefetchFile(const char *name)
+{
+    char            normalized[MAX_OSPATH];
+    char            fullpath[MAX_OSPATH];
+    searchpath_t    *search;
+    pack_t          *pak;
+    packfile_t      *entry;
+    size_t          namelen, len;
+    unsigned        hash;
+
+    if (fs_prefetch.thread) {
+        return;
+    }
+
+    namelen = FS_NormalizePathBuffer(normalized, name, sizeof(normalized));
+    if (namelen >= MAX_QPATH || FS_ValidatePath(normalized) == PATH_INVALID) {
+        return;
+    }
+
+    hash = FS_HashPath(normalized, 0);
+
+    for (search = fs_searchpaths; search; search = search->next) {
+        if (!search->pack) {
+            len = Q_concat(fullpath, sizeof(fullpath),
+                           search->filename, "/", normalized, NULL);
+            if (len < sizeof(fullpath)) {
+                prefetch_add(fullpath, 0, 0);
+            }
+            continue;
+        }
+
+        pak = search->pack;
+        entry = pak->file_hash[hash & (pak->hash_size - 1)];
+        for (; entry; entry = entry->hash_next) {
+            if (entry->namelen == namelen && !FS_pathcmp(entry->name, normalized)) {
+                break;
+            }
+        }
+        if (entry) {
+#if USE_ZLIB
+            prefetch_add(pak->filename, entry->filepos,
+                         entry->compmtd ? entry->complen : entry->filelen);
+#else
+            prefetch_add(pak->filename, entry->filepos, entry->filelen);
+#endif
+            break;
+        }
+    }
+
+    fs_prefetch.groups++;
+}
+
+/*
+================
+FS_StartPrefetch
+
+Starts reading the queued files in a background thread.
+================
+*/
+void FS_StartPrefetch(void)
+{
+    if (fs_prefetch.thread || !fs_prefetch.count) {
+        return;
+    }
+
+    fs_prefetch.lock = Sys_CreateMutex();
+    fs_prefetch.stop = qfalse;
+    fs_prefetch.thread = Sys_CreateThread(prefetch_thread, NULL);
+    if (!fs_prefetch.thread) {
+        FS_StopPrefetch();
+    }
+}
+
+/*
+================
+FS_StopPrefetch
+
+Stops reading ahead, waits for the thread and forgets queued files.
+================
+*/
+void FS_StopPrefetch(void)
+{
+    int i;
+
+    if (fs_prefetch.thread) {
+        Sys_LockMutex(fs_prefetch.lock);
+        fs_prefetch.stop = qtrue;
+        Sys_UnlockMutex(fs_prefetch.lock);
+        Sys_JoinThread(fs_prefetch.thread);
+    }
+
+    if (fs_prefetch.lock) {
+        Sys_DestroyMutex(fs_prefetch.lock);
+    }
+
+    for (i = 0; i < fs_prefetch.count; i++) {
+        Z_Free(fs_prefetch.items[i].path);
+    }
+    Z_Free(fs_prefetch.items);
+
+    memset(&fs_prefetch, 0, sizeof(fs_prefetch));
+}
+
+/*
+================
+FS_BeginRegistration
+
+Lets lookups list and cache loose directories and missing paths until the
+matching FS_EndRegistration. Calls may nest.
+================
+*/
+void FS_BeginRegistration(void)
+{
+    fs_registering++;
+}
+
+void FS_EndRegistration(void)
+{
+    if (fs_registering > 0 && --fs_registering == 0) {
+        index_flush_dirs();
+        miss_flush();
     }
+}
 
-    ret = get_fp_info(fp, &info);
-    if (ret) {
-        fclose(fp);
-        goto fail;
-    }
+/*
+================
+FS_AbortRegistration
 
-    file->type = FS_REAL;
-    file->fp = fp;
-    file->unique = qtrue;
-    file->error = Q_ERR_SUCCESS;
-    file->length = info.size;
+Ends registration regardless of depth and stops prefetching. Called when an
+error unwinds past FS_EndRegistration, so cached loose state doesn't outlive
+the level load.
+================
+*/
+void FS_AbortRegistration(void)
+{
+    FS_StopPrefetch();
 
-    FS_DPrintf("%s: %s: %"PRIz" bytes\n", __func__, fullpath, info.size);
-    return info.size;
+    if (fs_registering > 0) {
+        fs_registering = 1;
+        FS_EndRegistration();
+    }
+}
 
-fail:
-    FS_DPrintf("%s: %s: %s\n", __func__, fullpath, Q_ErrorString(ret));
-    return ret;
+static void fs_index_changed(cvar_t *self)
+{
+    if (fs_searchpaths) {
+        index_build();
+    }
 }
 
 // Finds the file in the search path.
@@ -1312,6 +2491,13 @@ static ssize_t open_file_read(file_t *file, const char *normalized, size_t namel
 
     FS_COUNT_READ;
 
+    // real files may be created behind our back, always look for them
+    if (fs_idx.hash && (file->mode & FS_TYPE_MASK) != FS_TYPE_REAL) {
+        if (index_open_file(file, normalized, namelen, unique, &ret)) {
+            return ret;
+        }
+    }
+
     hash = FS_HashPath(normalized, 0);
 
     valid = PATH_NOT_CHECKED;
@@ -1430,6 +2616,16 @@ static ssize_t expand_open_file_read(file_t *file, const char *name, qboolean un
         return Q_ERR_NAMETOOSHORT;
     }
 
+#if USE_TESTS
+    if (fs_record_file) {
+        FS_FPrintf(fs_record_file, "%#x %s\n", file->mode, name);
+    }
+#endif
+
+    if (miss_find(normalized, namelen, file->mode)) {
+        return Q_ERR_NOENT;
+    }
+
     ret = open_file_read(file, normalized, namelen, unique);
     if (ret == Q_ERR_NOENT) {
 // expand soft symlinks
@@ -1438,6 +2634,8 @@ static ssize_t expand_open_file_read(file_t *file, const char *name, qboolean un
                 return Q_ERR_NAMETOOLONG;
             }
             ret = open_file_read(file, normalized, namelen, unique);
+        } else {
+            miss_add(normalized, namelen, file->mode);
         }
     }
 
@@ -1564,6 +2762,9 @@ void FS_Flush(qhandle_t f)
     if (!file)
         return;
 
+    if (file->async)
+        async_drain(file);
+
     switch (file->type) {
     case FS_REAL:
         fflush(file->fp);
@@ -1586,7 +2787,6 @@ FS_Write
 ssize_t FS_Write(const void *buf, size_t len, qhandle_t f)
 {
     file_t  *file = file_for_handle(f);
-    size_t  result;
 
     if (!file)
         return Q_ERR_BADF;
@@ -1604,25 +2804,16 @@ ssize_t FS_Write(const void *buf, size_t len, qhandle_t f)
     if (len == 0)
         return 0;
 
-    switch (file->type) {
-    case FS_REAL:
-        result = fwrite(buf, 1, len, file->fp);
-        if (result != len) {
-            file->error = FS_ERR_WRITE(file->fp);
-            return file->error;
-        }
-        break;
-#if USE_ZLIB
-    case FS_GZ:
-        if (gzwrite(file->zfp, buf, len) == 0) {
-            file->error = Q_ERR_LIBRARY_ERROR;
-            return file->error;
-        }
-        break;
-#endif
-    default:
-        Com_Error(ERR_FATAL, "%s: bad file type", __func__);
-    }
+    if ((file->mode & FS_FLAG_ASYNC) && !file->async)
+        async_start(file);
+
+    if (file->async)
+        file->error = async_write(file, buf, len);
+    else
+        file->error = write_file(file, buf, len);
+
+    if (file->error)
+        return file->error;
 
     return len;
 }
@@ -1867,6 +3058,95 @@ done:
     return len;
 }
 
+/*
+================
+FS_MapFile
+
+Maps the file into memory if it is a plain file on disk or stored
+uncompressed in a pack, otherwise loads it like FS_LoadFile does. Data is
+read-only and not NUL terminated. Returned handle must be released with
+FS_UnmapFile.
+================
+*/
+ssize_t FS_MapFile(const char *path, const void **buffer, void **handle)
+{
+    file_t *file;
+    qhandle_t f;
+    fsmap_t *m;
+    size_t offset;
+    void *buf;
+    ssize_t len, read;
+
+    *buffer = NULL;
+    *handle = NULL;
+
+    if (!fs_searchpaths) {
+        return Q_ERR_AGAIN; // not yet initialized
+    }
+
+    file = alloc_handle(&f);
+    if (!file) {
+        return Q_ERR_MFILE;
+    }
+
+    file->mode = FS_MODE_READ;
+
+    len = expand_open_file_read(file, path, qfalse);
+    if (len < 0) {
+        return len;
+    }
+
+    if (len > MAX_LOADFILE) {
+        len = Q_ERR_FBIG;
+        goto done;
+    }
+
+    m = FS_Malloc(sizeof(*m));
+    m->map = NULL;
+
+    // keep lump data as aligned as it would be in a loaded buffer
+    offset = file->type == FS_PAK ? file->entry->filepos : 0;
+    if ((file->type == FS_REAL || file->type == FS_PAK) && !(offset & 3)) {
+        m->map = Sys_MapFile(file->fp, offset, len, buffer);
+    }
+
+    if (!m->map) {
+        buf = FS_Malloc(len + 1);
+        read = FS_Read(buf, len, f);
+        if (read != len) {
+            len = read < 0 ? read : Q_ERR_UNEXPECTED_EOF;
+            Z_Free(buf);
+            Z_Free(m);
+            goto done;
+        }
+        ((byte *)buf)[len] = 0;
+        *buffer = buf;
+    }
+
+    m->data = *buffer;
+    *handle = m;
+
+done:
+    FS_FCloseFile(f);
+    return len;
+}
+
+void FS_UnmapFile(void *handle)
+{
+    fsmap_t *m = handle;
+
+    if (!m) {
+        return;
+    }
+
+    if (m->map) {
+        Sys_UnmapFile(m->map);
+    } else {
+        Z_Free((void *)m->data);
+    }
+    Z_Free(m);
+}
+
 /*
 ================
 FS_WriteFile
@@ -1969,6 +3249,9 @@ qerror_t FS_RenameFile(const char *from, const char *to)
     if (rename(frompath, topath))
         return Q_Errno();
 
+    FS_InvalidatePath(from);
+    index_invalidate(normalized);
+
     return Q_ERR_SUCCESS;
 }
 
@@ -2061,6 +3344,261 @@ static void pack_hash_file(pack_t *pack, packfile_t *file)
     pack->file_hash[hash] = file;
 }
 
+/*
+=============================================================================
+
+PACK DIRECTORY CACHE
+
+Parsed pack directories are saved to BASEGAME/cache/packs under home (or
+base) directory, one file per pack, named after hash of the pack path.
+Cached directory is used if pack size and modification time still match,
+which replaces parsing, normalizing and hashing of every entry with a
+single read and fixing up of pointers.
+
+Layout is header, pack path, entries, hash heads and names, in native byte
+order. Anything that doesn't validate is ignored and rewritten.
+
+=============================================================================
+*/
+
+#define PACK_CACHE_IDENT    MakeRawLong('Q', '2', 'P', 'I')
+#define PACK_CACHE_VERSION  1
+
+typedef struct {
+    uint32_t    ident;
+    uint32_t    version;
+    uint32_t    type;
+    uint32_t    num_files;
+    uint32_t    hash_size;
+    uint32_t    names_len;
+    uint32_t    path_len;
+    uint32_t    pad;
+    uint64_t    size;
+    int64_t     mtime;
+} dpackcache_t;
+
+typedef struct {
+    uint32_t    name;       // offset into names
+    uint32_t    namelen;
+    uint32_t    filepos;
+    uint32_t    filelen;
+    uint32_t    complen;
+    uint32_t    compmtd;
+    uint32_t    hash_next;  // index + 1, chains point to lower indices only
+} dpackcachefile_t;
+
+static cvar_t       *fs_packcache;
+
+// pack load statistics of the last restart
+static unsigned     fs_packs_loaded;
+static unsigned     fs_packs_cached;
+static unsigned     fs_packs_usec;
+
+static qboolean pack_cache_path(char *buffer, size_t size, const char *packfile)
+{
+    const char *root = sys_homedir->string[0] ? sys_homedir->string : sys_basedir->string;
+
+    return Q_snprintf(buffer, size, "%s/" BASEGAME "/cache/packs/%08x.pki", root,
+                      Com_HashStringLen(packfile, SIZE_MAX, 0)) < size;
+}
+
+static pack_t *pack_cache_load(FILE *fp, filetype_t type, const char *packfile,
+                               const file_info_t *info)
+{
+    char path[MAX_OSPATH];
+    dpackcache_t header;
+    dpackcachefile_t *dfile;
+    packfile_t *file;
+    uint32_t *hash;
+    byte *data;
+    size_t len, path_len, max_files;
+    pack_t *pack = NULL;
+    unsigned i;
+    FILE *cfp;
+
+    if (!info || !fs_packcache->integer) {
+        return NULL;
+    }
+    if (!pack_cache_path(path, sizeof(path), packfile)) {
+        return NULL;
+    }
+
+    cfp = fopen(path, "rb");
+    if (!cfp) {
+        return NULL;
+    }
+
+    path_len = strlen(packfile) + 1;
+#if USE_ZLIB
+    max_files = type == FS_ZIP ? ZIP_MAXFILES : MAX_FILES_IN_PACK;
+#else
+    max_files = MAX_FILES_IN_PACK;
+#endif
+
+    if (fread(&header, 1, sizeof(header), cfp) != sizeof(header)) {
+        goto fail1;
+    }
+    if (header.ident != PACK_CACHE_IDENT || header.version != PACK_CACHE_VERSION) {
+        goto fail1;
+    }
+    if (header.type != type || header.size != info->size || header.mtime != info->mtime) {
+        goto fail1;
+    }
+    if (header.path_len != path_len || header.num_files < 1 || header.num_files > max_files) {
+        goto fail1;
+    }
+    if (header.hash_size != npot32(header.num_files / 3) || header.names_len > max_files * MAX_QPATH) {
+        goto fail1;
+    }
+
+    len = path_len + header.num_files * sizeof(*dfile) +
+          header.hash_size * sizeof(*hash) + header.names_len;
+    data = FS_AllocTempMem(len);
+    if (fread(data, 1, len, cfp) != len) {
+        goto fail2;
+    }
+    if (memcmp(data, packfile, path_len)) {
+        goto fail2;     // hash collision
+    }
+
+    dfile = (dpackcachefile_t *)(data + path_len);
+    hash = (uint32_t *)(dfile + header.num_files);
+
+    pack = pack_alloc(fp, type, packfile, header.num_files, header.names_len);
+    memcpy(pack->names, hash + header.hash_size, header.names_len);
+
+    for (i = 0, file = pack->files; i < header.num_files; i++, file++, dfile++) {
+        if (dfile->name >= header.names_len || dfile->namelen >= MAX_QPATH ||
+            dfile->namelen >= header.names_len - dfile->name ||
+            pack->names[dfile->name + dfile->namelen] || dfile->hash_next > i) {
+            goto fail3;
+        }
+        file->name = pack->names + dfile->name;
+        file->namelen = dfile->namelen;
+        file->filepos = dfile->filepos;
+        file->filelen = dfile->filelen;
+#if USE_ZLIB
+        file->complen = dfile->complen;
+        file->compmtd = dfile->compmtd;
+        file->coherent = type != FS_ZIP;
+#endif
+        file->hash_next = dfile->hash_next ? &pack->files[dfile->hash_next - 1] : NULL;
+    }
+
+    for (i = 0; i < header.hash_size; i++) {
+        if (hash[i] > header.num_files) {
+            goto fail3;
+        }
+        pack->file_hash[i] = hash[i] ? &pack->files[hash[i] - 1] : NULL;
+    }
+
+    FS_FreeTempMem(data);
+    fclose(cfp);
+    FS_DPrintf("%s: %s: %u files from cache\n", __func__, packfile, pack->num_files);
+    fs_packs_cached++;
+    return pack;
+
+fail3:
+    Z_Free(pack);
+    pack = NULL;
+fail2:
+    FS_FreeTempMem(data);
+fail1:
+    fclose(cfp);
+    FS_DPrintf("%s: %s: stale or bad cache\n", __func__, packfile);
+    return NULL;
+}
+
+static void pack_cache_save(pack_t *pack, const file_info_t *info)
+{
+    char path[MAX_OSPATH], temp[MAX_OSPATH];
+    dpackcache_t header;
+    dpackcachefile_t dfile;
+    packfile_t *file;
+    uint32_t index;
+    size_t names_len;
+    unsigned i;
+    FILE *fp;
+    int ret;
+
+    if (!info || !fs_packcache->integer) {
+        return;
+    }
+    if (!pack_cache_path(path, sizeof(path), pack->filename)) {
+        return;
+    }
+    if (Q_snprintf(temp, sizeof(temp), "%s.tmp", path) >= sizeof(temp)) {
+        return;
+    }
+    if (FS_CreatePath(temp)) {
+        return;
+    }
+
+    fp = fopen(temp, "wb");
+    if (!fp) {
+        FS_DPrintf("%s: %s: %s\n", __func__, temp, strerror(errno));
+        return;
+    }
+
+    // names are stored back to back right after the filename
+    names_len = 0;
+    for (i = 0, file = pack->files; i < pack->num_files; i++, file++) {
+        names_len = max(names_len, file->name + file->namelen + 1 - pack->names);
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.ident = PACK_CACHE_IDENT;
+    header.version = PACK_CACHE_VERSION;
+    header.type = pack->type;
+    header.num_files = pack->num_files;
+    header.hash_size = pack->hash_size;
+    header.names_len = names_len;
+    header.path_len = strlen(pack->filename) + 1;
+    header.size = info->size;
+    header.mtime = info->mtime;
+
+    fwrite(&header, 1, sizeof(header), fp);
+    fwrite(pack->filename, 1, header.path_len, fp);
+
+    memset(&dfile, 0, sizeof(dfile));
+    for (i = 0, file = pack->files; i < pack->num_files; i++, file++) {
+        dfile.name = file->name - pack->names;
+        dfile.namelen = file->namelen;
+        dfile.filepos = file->filepos;
+        dfile.filelen = file->filelen;
+#if USE_ZLIB
+        dfile.complen = file->complen;
+        dfile.compmtd = file->compmtd;
+#endif
+        dfile.hash_next = file->hash_next ? file->hash_next - pack->files + 1 : 0;
+        fwrite(&dfile, 1, sizeof(dfile), fp);
+    }
+
+    for (i = 0; i < pack->hash_size; i++) {
+        index = pack->file_hash[i] ? pack->file_hash[i] - pack->files + 1 : 0;
+        fwrite(&index, 1, sizeof(index), fp);
+    }
+
+    fwrite(pack->names, 1, names_len, fp);
+
+    ret = ferror(fp);
+    if (fclose(fp)) {
+        ret = -1;
+    }
+    if (ret) {
+        FS_DPrintf("%s: %s: write error\n", __func__, temp);
+        remove(temp);
+        return;
+    }
+
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (rename(temp, path)) {
+        remove(temp);
+    }
+}
+
 // Loads the header and directory, adding the files at the beginning
 // of the list so they override previous pack files.
 static pack_t *load_pak_file(const char *packfile)
@@ -2073,6 +3611,7 @@ static pack_t *load_pak_file(const char *packfile)
     size_t          len, names_len;
     pack_t          *pack;
     FILE            *fp;
+    file_info_t     st, *stp;
     dpackfile_t     info[MAX_FILES_IN_PACK];
 
     fp = fopen(packfile, "rb");
@@ -2081,6 +3620,12 @@ static pack_t *load_pak_file(const char *packfile)
         return NULL;
     }
 
+    stp = get_fp_info(fp, &st) ? NULL : &st;
+    pack = pack_cache_load(fp, FS_PAK, packfile, stp);
+    if (pack) {
+        return pack;
+    }
+
     if (fread(&header, 1, sizeof(header), fp) != sizeof(header)) {
         Com_Printf("Reading header failed on %s\n", packfile);
         goto fail;
@@ -2158,6 +3703,8 @@ static pack_t *load_pak_file(const char *packfile)
     FS_DPrintf("%s: %u files, %u hash\n",
                packfile, pack->num_files, pack->hash_size);
 
+    pack_cache_save(pack, stp);
+
     return pack;
 
 fail:
@@ -2300,6 +3847,7 @@ static pack_t *load_zip_file(const char *packfile)
     size_t          extra_bytes, ofs;
     pack_t          *pack;
     FILE            *fp;
+    file_info_t     st, *stp;
     byte            header[ZIP_SIZECENTRALHEADER];
 
     fp = fopen(packfile, "rb");
@@ -2308,6 +3856,12 @@ static pack_t *load_zip_file(const char *packfile)
         return NULL;
     }
 
+    stp = get_fp_info(fp, &st) ? NULL : &st;
+    pack = pack_cache_load(fp, FS_ZIP, packfile, stp);
+    if (pack) {
+        return pack;
+    }
+
     header_pos = search_central_header(fp);
     if (!header_pos) {
         Com_Printf("No central header found in %s\n", packfile);
@@ -2414,6 +3968,8 @@ static pack_t *load_zip_file(const char *packfile)
     FS_DPrintf("%s: %u files, %u skipped, %u hash\n",
                packfile, pack->num_files, num_files_cd - pack->num_files, pack->hash_size);
 
+    pack_cache_save(pack, stp);
+
     return pack;
 
 fail1:
@@ -2465,6 +4021,7 @@ static void q_printf(2, 3) add_game_dir(unsigned mode, const char *fmt, ...)
     int             i, count;
     char            path[MAX_OSPATH];
     size_t          len;
+    uint64_t        start;
 
     va_start(argptr, fmt);
     len = Q_vsnprintf(fs_gamedir, sizeof(fs_gamedir), fmt, argptr);
@@ -2502,6 +4059,8 @@ static void q_printf(2, 3) add_game_dir(unsigned mode, const char *fmt, ...)
 
     qsort(files, count, sizeof(files[0]), pakcmp);
 
+    start = Sys_Microseconds();
+
     for (i = 0; i < count; i++) {
         len = Q_concat(path, sizeof(path), fs_gamedir, "/", files[i], NULL);
         if (len >= sizeof(path)) {
@@ -2517,6 +4076,7 @@ static void q_printf(2, 3) add_game_dir(unsigned mode, const char *fmt, ...)
             pack = load_pak_file(path);
         if (!pack)
             continue;
+        fs_packs_loaded++;
         search = FS_Malloc(sizeof(searchpath_t));
         search->mode = mode;
         search->filename[0] = 0;
@@ -2525,6 +4085,8 @@ static void q_printf(2, 3) add_game_dir(unsigned mode, const char *fmt, ...)
         fs_searchpaths = search;
     }
 
+    fs_packs_usec += Sys_Microseconds() - start;
+
     for (i = 0; i < count; i++) {
         Z_Free(files[i]);
     }
@@ -3235,6 +4797,16 @@ static void FS_Stats_f(void)
     Com_Printf("Total path comparsions: %d\n", fs_count_strcmp);
     Com_Printf("Total calls to open_from_disk: %d\n", fs_count_open);
     Com_Printf("Total mixed-case reopens: %d\n", fs_count_strlwr);
+    Com_Printf("Total directory listings: %d, index fallbacks: %d\n",
+               fs_count_list, fs_count_fallback);
+    Com_Printf("Negative cache: %u paths, %u hits, %u added, %u flushes\n",
+               fs_miss.count, fs_miss.hits, fs_miss.added, fs_miss.flushes);
+    Com_Printf("Path index: %u pack files, %u loose files in %u directories, %u buckets\n",
+               fs_idx.num_packfiles, fs_idx.num_loose, fs_idx.num_dirs, fs_idx.hash_size);
+    Com_Printf("Total async bytes written: %"PRIz", max buffered: %"PRIz"\n",
+               fs_async_bytes, fs_async_maxfill);
+    Com_Printf("Total async writer stalls: %u (%u msec)\n",
+               fs_async_stalls, fs_async_stallmsec);
 
     if (!totalHashSize) {
         Com_Printf("No stats to display\n");
@@ -3251,6 +4823,41 @@ static void FS_Stats_f(void)
 }
 #endif // _DEBUG
 
+#if USE_TESTS
+/*
+================
+FS_Record_f
+
+Records read lookups as they are made, to be replayed by fsbench.
+================
+*/
+static void FS_Record_f(void)
+{
+    qhandle_t f;
+
+    if (fs_record_file) {
+        Com_Printf("Stopped recording %s.\n", fs_record_name);
+        FS_FCloseFile(fs_record_file);
+        fs_record_file = 0;
+        return;
+    }
+
+    if (Cmd_Argc() != 2) {
+        Com_Printf("Usage: %s <filename>\n", Cmd_Argv(0));
+        return;
+    }
+
+    f = FS_EasyOpenFile(fs_record_name, sizeof(fs_record_name),
+                        FS_MODE_WRITE | FS_FLAG_TEXT, "profile/", Cmd_Argv(1), ".txt");
+    if (!f) {
+        return;
+    }
+
+    Com_Printf("Recording lookups to %s.\n", fs_record_name);
+    fs_record_file = f;
+}
+#endif
+
 static void FS_Link_g(genctx_t *ctx)
 {
     list_t *list;
@@ -3312,6 +4919,7 @@ static void FS_UnLink_f(void)
             Cmd_PrintHelp(options);
             return;
         case 'a':
+            miss_flush();
             free_all_links(list);
             Com_Printf("Deleted all symbolic links.\n");
             return;
@@ -3329,6 +4937,7 @@ static void FS_UnLink_f(void)
 
     FOR_EACH_SYMLINK(link, list) {
         if (!FS_pathcmp(link->name, name)) {
+            miss_flush();
             List_Remove(&link->entry);
             Z_Free(link->target);
             Z_Free(link);
@@ -3386,6 +4995,8 @@ static void FS_Link_f(void)
         return;
     }
 
+    miss_flush();
+
     // search for existing link with this name
     FOR_EACH_SYMLINK(link, list) {
         if (!FS_pathcmp(link->name, name)) {
@@ -3415,6 +5026,9 @@ static void free_all_paths(void)
 {
     searchpath_t *path, *next;
 
+    index_free();
+    miss_flush();
+
     for (path = fs_searchpaths; path; path = next) {
         next = path->next;
         free_search_path(path);
@@ -3427,6 +5041,9 @@ static void free_game_paths(void)
 {
     searchpath_t *path, *next;
 
+    index_free();
+    miss_flush();
+
     for (path = fs_searchpaths; path != fs_base_searchpaths; path = next) {
         next = path->next;
         free_search_path(path);
@@ -3483,6 +5100,14 @@ static void setup_game_paths(void)
 
     // this var is used by the game library to find it's home directory
     Cvar_FullSet("fs_gamedir", fs_gamedir, CVAR_ROM, FROM_CODE);
+
+    index_build();
+
+    if (fs_packs_loaded) {
+        Com_Printf("Loaded %u pack%s (%u cached) in %u usec\n", fs_packs_loaded,
+                   fs_packs_loaded == 1 ? "" : "s", fs_packs_cached, fs_packs_usec);
+    }
+    fs_packs_loaded = fs_packs_cached = fs_packs_usec = 0;
 }
 
 /*
@@ -3496,6 +5121,10 @@ void FS_Restart(qboolean total)
 {
     Com_Printf("----- FS_Restart -----\n");
 
+    // pending preloads may come from the old search path
+    BSP_Preload(NULL);
+    FS_StopPrefetch();
+
     if (total) {
         // perform full reset
         free_all_paths();
@@ -3541,6 +5170,9 @@ static const cmdreg_t c_fs[] = {
     { "softlink", FS_Link_f, FS_Link_c },
     { "softunlink", FS_UnLink_f, FS_Link_c },
     { "fs_restart", FS_Restart_f },
+#if USE_TESTS
+    { "fs_record", FS_Record_f },
+#endif
 
     { NULL }
 };
@@ -3559,6 +5191,15 @@ void FS_Shutdown(void)
         return;
     }
 
+    FS_StopPrefetch();
+
+#if USE_TESTS
+    if (fs_record_file) {
+        FS_FCloseFile(fs_record_file);
+        fs_record_file = 0;
+    }
+#endif
+
     // close file handles
     for (i = 0, file = fs_files; i < MAX_FILE_HANDLES; i++, file++) {
         if (file->type != FS_FREE) {
@@ -3648,6 +5289,12 @@ void FS_Init(void)
     fs_debug = Cvar_Get("fs_debug", "0", 0);
 #endif
 
+    fs_index = Cvar_Get("fs_index", "1", 0);
+    fs_index->changed = fs_index_changed;
+    fs_negcache = Cvar_Get("fs_negcache", "1", 0);
+    fs_negcache->changed = fs_negcache_changed;
+    fs_packcache = Cvar_Get("fs_packcache", "1", 0);
+
     // get the game cvar and start the filesystem
     fs_game = Cvar_Get("game", DEFGAME, CVAR_LATCH | CVAR_SERVERINFO);
     fs_game->changed = fs_game_changed;
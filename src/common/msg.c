@@ -216,7 +216,7 @@ void MSG_WriteAngle(float f)
     MSG_WriteByte(ANGLE2BYTE(f));
 }
 
-#if USE_CLIENT
+#if USE_CLIENT || USE_TESTS
 
 /*
 =============
@@ -317,8 +317,10 @@ MSG_WriteBits
 */
 void MSG_WriteBits(int value, int bits)
 {
-    int i;
     size_t bitpos;
+    byte *data;
+    uint64_t word;
+    int shift, count;
 
     if (bits == 0 || bits < -31 || bits > 32) {
         Com_Error(ERR_FATAL, "MSG_WriteBits: bad bits: %d", bits);
@@ -332,30 +334,24 @@ void MSG_WriteBits(int value, int bits)
         bits = -bits;
     }
 
+    // merge value with partially written byte and store up to 5 bytes
     bitpos = msg_write.bitpos;
-    if ((bitpos & 7) == 0) {
-        // optimized case
-        switch (bits) {
-        case 8:
-            MSG_WriteByte(value);
-            return;
-        case 16:
-            MSG_WriteShort(value);
-            return;
-        case 32:
-            MSG_WriteLong(value);
-            return;
-        default:
-            break;
-        }
-    }
-    for (i = 0; i < bits; i++, bitpos++) {
-        if ((bitpos & 7) == 0) {
-            msg_write.data[bitpos >> 3] = 0;
-        }
-        msg_write.data[bitpos >> 3] |= (value & 1) << (bitpos & 7);
-        value >>= 1;
+    data = msg_write.data + (bitpos >> 3);
+    shift = bitpos & 7;
+    count = (shift + bits + 7) >> 3;
+
+    word = (uint32_t)value & (0xffffffffU >> (32 - bits));
+    word <<= shift;
+    if (shift) {
+        word |= data[0];
     }
+
+    do {
+        *data++ = (byte)word;
+        word >>= 8;
+    } while (--count);
+
+    bitpos += bits;
     msg_write.bitpos = bitpos;
     msg_write.cursize = (bitpos + 7) >> 3;
 }
@@ -455,7 +451,7 @@ int MSG_WriteDeltaUsercmd_Enhanced(const usercmd_t *from,
     return bits;
 }
 
-#endif // USE_CLIENT
+#endif // USE_CLIENT || USE_TESTS
 
 void MSG_WriteDir(const vec3_t dir)
 {
@@ -537,6 +533,12 @@ void MSG_WriteDeltaEntity(const entity_packed_t *from,
     if (!from)
         from = &nullEntityState;
 
+    // common case of an entity that didn't change at all
+    if (!(flags & (MSG_ES_FORCE | MSG_ES_NEWENTITY)) && !to->event &&
+        !(to->renderfx & (RF_FRAMELERP | RF_BEAM)) &&
+        !memcmp(from, to, sizeof(*to)))
+        return;
+
 // send an update
     bits = 0;
 
@@ -792,6 +794,33 @@ void MSG_PackPlayer(player_packed_t *out, const player_state_t *in)
         out->stats[i] = in->stats[i];
 }
 
+/*
+=============
+MSG_StatBits
+
+Returns mask of changed stats. Compares four stats at a time, most
+of them don't change between frames.
+=============
+*/
+static int MSG_StatBits(const int16_t *from, const int16_t *to)
+{
+    uint64_t    a, b;
+    int         i, j, bits;
+
+    bits = 0;
+    for (i = 0; i < MAX_STATS; i += 4) {
+        memcpy(&a, from + i, sizeof(a));
+        memcpy(&b, to + i, sizeof(b));
+        if (a == b)
+            continue;
+        for (j = i; j < i + 4; j++)
+            if (to[j] != from[j])
+                bits |= 1 << j;
+    }
+
+    return bits;
+}
+
 void MSG_WriteDeltaPlayerstate_Default(const player_packed_t *from, const player_packed_t *to)
 {
     int     i;
@@ -804,6 +833,13 @@ void MSG_WriteDeltaPlayerstate_Default(const player_packed_t *from, const player
     if (!from)
         from = &nullPlayerState;
 
+    // nothing changed at all
+    if (!memcmp(from, to, sizeof(*to))) {
+        MSG_WriteShort(0);
+        MSG_WriteLong(0);
+        return;
+    }
+
     //
     // determine what needs to be sent
     //
@@ -961,10 +997,7 @@ void MSG_WriteDeltaPlayerstate_Default(const player_packed_t *from, const player
         MSG_WriteByte(to->rdflags);
 
     // send stats
-    statbits = 0;
-    for (i = 0; i < MAX_STATS; i++)
-        if (to->stats[i] != from->stats[i])
-            statbits |= 1 << i;
+    statbits = MSG_StatBits(from->stats, to->stats);
 
     MSG_WriteLong(statbits);
     for (i = 0; i < MAX_STATS; i++)
@@ -1114,10 +1147,7 @@ int MSG_WriteDeltaPlayerstate_Enhanced(const player_packed_t    *from,
         to->gunangles[2] = from->gunangles[2];
     }
 
-    statbits = 0;
-    for (i = 0; i < MAX_STATS; i++)
-        if (to->stats[i] != from->stats[i])
-            statbits |= 1 << i;
+    statbits = MSG_StatBits(from->stats, to->stats);
 
     if (statbits)
         eflags |= EPS_STATS;
@@ -1326,10 +1356,7 @@ void MSG_WriteDeltaPlayerstate_Packet(const player_packed_t *from,
             pflags |= PPS_GUNANGLES;
     }
 
-    statbits = 0;
-    for (i = 0; i < MAX_STATS; i++)
-        if (to->stats[i] != from->stats[i])
-            statbits |= 1 << i;
+    statbits = MSG_StatBits(from->stats, to->stats);
 
     if (statbits)
         pflags |= PPS_STATS;
@@ -1719,10 +1746,11 @@ void MSG_ReadDeltaUsercmd_Hacked(const usercmd_t *from, usercmd_t *to)
 
 int MSG_ReadBits(int bits)
 {
-    int i, get;
     size_t bitpos;
+    byte *data;
+    uint64_t word;
     qboolean sgn;
-    int value;
+    int value, shift, count, i;
 
     if (bits == 0 || bits < -31 || bits > 32) {
         Com_Error(ERR_FATAL, "MSG_ReadBits: bad bits: %d", bits);
@@ -1755,11 +1783,18 @@ int MSG_ReadBits(int bits)
         sgn = qtrue;
     }
 
-    value = 0;
-    for (i = 0; i < bits; i++, bitpos++) {
-        get = (msg_read.data[bitpos >> 3] >> (bitpos & 7)) & 1;
-        value |= get << i;
+    // gather up to 5 bytes covering the field
+    data = msg_read.data + (bitpos >> 3);
+    shift = bitpos & 7;
+    count = (shift + bits + 7) >> 3;
+
+    word = 0;
+    for (i = 0; i < count; i++) {
+        word |= (uint64_t)data[i] << (i * 8);
     }
+    value = (int)(uint32_t)((word >> shift) & (0xffffffffU >> (32 - bits)));
+
+    bitpos += bits;
     msg_read.bitpos = bitpos;
     msg_read.readcount = (bitpos + 7) >> 3;
 
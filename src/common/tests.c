@@ -17,10 +17,13 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "shared/shared.h"
+#include "client/sound/sound.h"
 #include "common/bsp.h"
 #include "common/cmd.h"
 #include "common/common.h"
 #include "common/files.h"
+#include "common/msg.h"
+#include "common/sizebuf.h"
 #include "common/tests.h"
 #include "refresh/refresh.h"
 #include "system/system.h"
@@ -155,6 +158,186 @@ static void BSP_Test_f(void)
     FS_FreeList(list);
 }
 
+#define VISBENCH_ROWS   256
+
+// bit and byte at a time versions of the vis row kernels, for reference
+static void vis_or_ref(byte *dst, const byte *src, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        dst[i] |= src[i];
+}
+
+static void vis_and_ref(byte *dst, const byte *src, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        dst[i] &= src[i];
+}
+
+static int vis_count_ref(const byte *row, int size)
+{
+    int i, count = 0;
+
+    for (i = 0; i < size << 3; i++)
+        count += Q_IsBitSet(row, i);
+
+    return count;
+}
+
+static int vis_bits_ref(const byte *row, int size, int *bits)
+{
+    int i, j, count = 0;
+
+    for (i = 0; i < size; i++) {
+        if (!row[i])
+            continue;
+        for (j = 0; j < 8; j++) {
+            if (row[i] & (1 << j))
+                bits[count++] = i * 8 + j;
+        }
+    }
+
+    return count;
+}
+
+// times vis row kernels against the reference loops on PVS rows spread
+// evenly over the map, returns qfalse if any result differs
+static qboolean BSP_BenchVis(const char *name, int passes)
+{
+    static const char *const opnames[] = { "or", "and", "count", "iterate" };
+    byte acc[2][VIS_MAX_BYTES], and[2][VIS_MAX_BYTES];
+    static int bits[MAX_MAP_LEAFS];
+    int i, j, k, n, size, numclusters, numrows, count[2], calls;
+    unsigned sum[2];
+    uint64_t start, decompress, time[4][2];
+    qboolean ok;
+    qerror_t ret;
+    bsp_t *bsp;
+    byte *rows;
+
+    ret = BSP_Load(name, &bsp);
+    if (!bsp) {
+        Com_EPrintf("%s: %s\n", name, Q_ErrorString(ret));
+        return qfalse;
+    }
+
+    if (!bsp->vis) {
+        Com_Printf("%s: no vis\n", name);
+        BSP_Free(bsp);
+        return qtrue;
+    }
+
+    size = bsp->visrowsize;
+    numclusters = bsp->vis->numclusters;
+    numrows = min(numclusters, VISBENCH_ROWS);
+    rows = Z_Malloc(numrows * size);
+
+    start = Sys_Microseconds();
+    for (i = 0; i < passes; i++) {
+        for (j = 0; j < numrows; j++)
+            BSP_ClusterVis(bsp, rows + j * size, j * numclusters / numrows, DVIS_PVS);
+    }
+    decompress = Sys_Microseconds() - start;
+
+    for (k = 0; k < 2; k++) {
+        memset(acc[k], 0, size);
+        memset(and[k], 0xff, size);
+        count[k] = sum[k] = 0;
+
+        start = Sys_Microseconds();
+        for (i = 0; i < passes; i++) {
+            for (j = 0; j < numrows; j++) {
+                if (k)
+                    BSP_VisOr(acc[k], rows + j * size, size);
+                else
+                    vis_or_ref(acc[k], rows + j * size, size);
+            }
+        }
+        time[0][k] = Sys_Microseconds() - start;
+
+        start = Sys_Microseconds();
+        for (i = 0; i < passes; i++) {
+            for (j = 0; j < numrows; j++) {
+                if (k)
+                    BSP_VisAnd(and[k], rows + j * size, size);
+                else
+                    vis_and_ref(and[k], rows + j * size, size);
+            }
+        }
+        time[1][k] = Sys_Microseconds() - start;
+
+        start = Sys_Microseconds();
+        for (i = 0; i < passes; i++) {
+            for (j = 0; j < numrows; j++)
+                count[k] += k ? BSP_VisCount(rows + j * size, size) : vis_count_ref(rows + j * size, size);
+        }
+        time[2][k] = Sys_Microseconds() - start;
+
+        start = Sys_Microseconds();
+        for (i = 0; i < passes; i++) {
+            for (j = 0; j < numrows; j++) {
+                n = k ? BSP_VisBits(rows + j * size, size, bits) : vis_bits_ref(rows + j * size, size, bits);
+                while (n--)
+                    sum[k] += bits[n];
+            }
+        }
+        time[3][k] = Sys_Microseconds() - start;
+    }
+
+    ok = !memcmp(acc[0], acc[1], size) && !memcmp(and[0], and[1], size) &&
+        count[0] == count[1] && sum[0] == sum[1];
+
+    calls = passes * numrows;
+    Com_Printf("%s: %d clusters, %d bytes per row, %.1f%% set, "
+               "decompress %.1f nsec per call\n", name, numclusters, size,
+               count[1] * 100.0 / ((double)calls * numclusters),
+               decompress * 1000.0 / calls);
+    for (i = 0; i < 4; i++) {
+        Com_Printf("  %-8s %8.1f nsec per call, %8.1f bytewise\n", opnames[i],
+                   time[i][1] * 1000.0 / calls, time[i][0] * 1000.0 / calls);
+    }
+    if (!ok)
+        Com_EPrintf("%s: vis row kernels disagree with reference\n", name);
+
+    Z_Free(rows);
+    BSP_Free(bsp);
+    return ok;
+}
+
+// visbench [map] [passes]
+static void BSP_BenchVis_f(void)
+{
+    void **list;
+    int i, count, errors, passes;
+
+    passes = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 100;
+    clamp(passes, 1, 100000);
+
+    if (Cmd_Argc() > 1) {
+        BSP_BenchVis(va("maps/%s.bsp", Cmd_Argv(1)), passes);
+        return;
+    }
+
+    list = FS_ListFiles("maps", ".bsp", FS_SEARCH_SAVEPATH, &count);
+    if (!list) {
+        Com_Printf("No maps found\n");
+        return;
+    }
+
+    errors = 0;
+    for (i = 0; i < count; i++) {
+        if (!BSP_BenchVis(list[i], passes))
+            errors++;
+    }
+
+    Com_Printf("%d failures, %d maps tested\n", errors, count);
+
+    FS_FreeList(list);
+}
+
 typedef struct {
     const char *filter;
     const char *string;
@@ -492,14 +675,385 @@ static void Com_TestSnprintf_f(void)
     Com_Printf("%d failures, %d strings tested\n", errors, num_snprintf_tests * 2);
 }
 
+#if USE_CLIENT
+
+// bit at a time reference implementation of MSG_WriteBits/MSG_ReadBits
+static size_t ref_write_bits(byte *data, size_t bitpos, int value, int bits)
+{
+    int i;
+
+    if (bits < 0)
+        bits = -bits;
+
+    for (i = 0; i < bits; i++, bitpos++) {
+        if ((bitpos & 7) == 0)
+            data[bitpos >> 3] = 0;
+        data[bitpos >> 3] |= (value & 1) << (bitpos & 7);
+        value >>= 1;
+    }
+
+    return bitpos;
+}
+
+static int ref_read_bits(const byte *data, size_t *bitpos, int bits)
+{
+    int i, value, sgn = 0;
+
+    if (bits < 0) {
+        bits = -bits;
+        sgn = 1;
+    }
+
+    value = 0;
+    for (i = 0; i < bits; i++, (*bitpos)++)
+        value |= ((data[*bitpos >> 3] >> (*bitpos & 7)) & 1) << i;
+
+    if (sgn && (value & (1 << (bits - 1))))
+        value |= -1 ^ ((1 << bits) - 1);
+
+    return value;
+}
+
+static uint32_t bits_seed;
+
+static uint32_t bits_rand(void)
+{
+    bits_seed = bits_seed * 1103515245 + 12345;
+    return bits_seed ^ (bits_seed >> 16);
+}
+
+#define MAX_BIT_FIELDS  64
+
+// round trip random bit fields through MSG_WriteBits/MSG_ReadBits,
+// comparing against the reference implementation, then time both
+static void Com_TestBits_f(void)
+{
+    int values[MAX_BIT_FIELDS], widths[MAX_BIT_FIELDS];
+    byte ref[MAX_BIT_FIELDS * 5];
+    size_t bitpos;
+    int i, j, n = 0, count, errors, value;
+    unsigned start, ref_msec, msg_msec;
+
+    count = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 100000;
+    bits_seed = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 1;
+
+    errors = 0;
+    for (i = 0; i < count && errors < 10; i++) {
+        n = 1 + bits_rand() % MAX_BIT_FIELDS;
+        for (j = 0; j < n; j++) {
+            do {
+                widths[j] = (int)(bits_rand() % 64) - 31;
+            } while (!widths[j]);
+            values[j] = bits_rand();
+        }
+
+        bitpos = 0;
+        for (j = 0; j < n; j++)
+            bitpos = ref_write_bits(ref, bitpos, values[j], widths[j]);
+
+        MSG_BeginWriting();
+        for (j = 0; j < n; j++)
+            MSG_WriteBits(values[j], widths[j]);
+
+        if (msg_write.cursize != (bitpos + 7) >> 3 ||
+            memcmp(msg_write.data, ref, msg_write.cursize)) {
+            Com_EPrintf("MSG_WriteBits mismatch on message %d\n", i);
+            errors++;
+            continue;
+        }
+
+        SZ_Init(&msg_read, msg_read_buffer, MAX_MSGLEN);
+        memcpy(msg_read_buffer, msg_write.data, msg_write.cursize);
+        msg_read.cursize = msg_write.cursize;
+
+        MSG_BeginReading();
+        for (j = 0, bitpos = 0; j < n; j++) {
+            value = MSG_ReadBits(widths[j]);
+            if (value != ref_read_bits(ref, &bitpos, widths[j])) {
+                Com_EPrintf("MSG_ReadBits mismatch on message %d field %d\n", i, j);
+                errors++;
+                break;
+            }
+        }
+    }
+
+    Com_Printf("%d failures, %d messages tested\n", errors, i);
+
+    // time the last message, which is now in both buffers
+    start = Sys_Milliseconds();
+    for (i = 0; i < count; i++) {
+        bitpos = 0;
+        for (j = 0; j < n; j++)
+            bitpos = ref_write_bits(ref, bitpos, values[j], widths[j]);
+        for (j = 0, bitpos = 0; j < n; j++)
+            ref_read_bits(ref, &bitpos, widths[j]);
+    }
+    ref_msec = Sys_Milliseconds() - start;
+
+    start = Sys_Milliseconds();
+    for (i = 0; i < count; i++) {
+        MSG_BeginWriting();
+        for (j = 0; j < n; j++)
+            MSG_WriteBits(values[j], widths[j]);
+        MSG_BeginReading();
+        for (j = 0; j < n; j++)
+            MSG_ReadBits(widths[j]);
+    }
+    msg_msec = Sys_Milliseconds() - start;
+
+    SZ_Clear(&msg_write);
+    SZ_Clear(&msg_read);
+
+    Com_Printf("%d fields x %d: %u msec (reference %u msec)\n",
+               n, count, msg_msec, ref_msec);
+}
+
+#if USE_SNDDMA
+
+// sum looped sounds of synthetic emitters in one pass and with the
+// per-type rescan it replaced, checking that both agree
+static void Com_TestLoopSounds_f(void)
+{
+    int count, types, frames, errors;
+    unsigned msec, ref_msec;
+
+    count = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 600;
+    types = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 40;
+    frames = Cmd_Argc() > 3 ? atoi(Cmd_Argv(3)) : 10000;
+
+    errors = S_TestLoopSounds(count, types, frames, &msec, &ref_msec);
+    if (errors < 0) {
+        Com_Printf("Sound system not initialized\n");
+        return;
+    }
+
+    Com_Printf("%d failures\n", errors);
+    Com_Printf("%d emitters, %d types x %d: %u msec (reference %u msec)\n",
+               count, types, frames, msec, ref_msec);
+}
+
+#endif
+
+#endif // USE_CLIENT
+
+static qhandle_t write_test(const char *name, unsigned mode, int count)
+{
+    byte buf[1400];
+    uint32_t msglen;
+    qhandle_t f;
+    int i, j;
+
+    FS_FOpenFile(name, &f, mode);
+    if (!f) {
+        return 0;
+    }
+    if ((mode & FS_FLAG_GZIP) && FS_FilterFile(f)) {
+        FS_FCloseFile(f);
+        return 0;
+    }
+
+    // demo-like stream of length prefixed messages
+    for (i = 0; i < count; i++) {
+        msglen = 64 + (i * 7919) % 1336;
+        for (j = 0; j < msglen; j++)
+            buf[j] = i + j * (j >> 4);
+        FS_Write(&msglen, 4, f);
+        FS_Write(buf, msglen, f);
+    }
+
+    return f;
+}
+
+static void Com_TestWrite_f(void)
+{
+    static const char *const names[2] = {
+        "writetest_sync.tmp", "writetest_async.tmp"
+    };
+    unsigned mode, start, write_msec[2], close_msec[2];
+    void *data[2];
+    ssize_t len[2];
+    qhandle_t f;
+    int i, count;
+
+    // keep within MAX_LOADFILE for comparison
+    count = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 20000;
+    mode = FS_MODE_WRITE;
+    if (Cmd_Argc() > 2 && !strcmp(Cmd_Argv(2), "-z"))
+        mode |= FS_FLAG_GZIP;
+
+    for (i = 0; i < 2; i++) {
+        start = Sys_Milliseconds();
+        f = write_test(names[i], i ? mode | FS_FLAG_ASYNC : mode, count);
+        write_msec[i] = Sys_Milliseconds() - start;
+        FS_FCloseFile(f);
+        close_msec[i] = Sys_Milliseconds() - start - write_msec[i];
+    }
+
+    for (i = 0; i < 2; i++)
+        len[i] = FS_LoadFile(names[i], &data[i]);
+
+    if (len[0] < 0 || len[1] < 0) {
+        Com_EPrintf("Couldn't load test files\n");
+    } else if (len[0] != len[1] || memcmp(data[0], data[1], len[0])) {
+        Com_EPrintf("Async file differs from sync file\n");
+    } else {
+        Com_Printf("%"PRIz" bytes: sync %u+%u msec, async %u+%u msec (write+close)\n",
+                   len[0], write_msec[0], close_msec[0], write_msec[1], close_msec[1]);
+    }
+
+    for (i = 0; i < 2; i++) {
+        if (len[i] > 0)
+            FS_FreeFile(data[i]);
+        remove(va("%s/%s", fs_gamedir, names[i]));
+    }
+}
+
+// replays lookups recorded by fs_record with and without lookup caches
+static void Com_TestFs_f(void)
+{
+    char *data, *s, *p, **names;
+    unsigned *modes;
+    int i, j, k, count, found, passes, index, negcache;
+    uint64_t start, cold, warm;
+    ssize_t len;
+
+    if (Cmd_Argc() < 2) {
+        Com_Printf("Usage: %s <trace> [passes]\n", Cmd_Argv(0));
+        return;
+    }
+
+    len = FS_LoadFile(va("profile/%s.txt", Cmd_Argv(1)), (void **)&data);
+    if (!data) {
+        Com_EPrintf("Couldn't load trace: %s\n", Q_ErrorString(len));
+        return;
+    }
+
+    passes = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 10;
+    clamp(passes, 2, 1000);
+
+    // last line may lack a newline
+    count = 1;
+    for (s = data; *s; s++)
+        if (*s == '\n')
+            count++;
+
+    names = Z_Malloc(sizeof(names[0]) * count);
+    modes = Z_Malloc(sizeof(modes[0]) * count);
+
+    for (i = 0, s = data; i < count && s && *s; s = p) {
+        p = strchr(s, '\n');
+        if (p)
+            *p++ = 0;
+        modes[i] = strtoul(s, &s, 16);
+        if (*s++ != ' ')
+            continue;
+        names[i++] = s;
+    }
+    count = i;
+
+    index = Cvar_VariableInteger("fs_index");
+    negcache = Cvar_VariableInteger("fs_negcache");
+
+    for (i = 0; i < 4; i++) {
+        // toggling drops all cached state, so first pass is a cold one
+        Cvar_SetEx("fs_index", "0", FROM_CONSOLE);
+        Cvar_SetEx("fs_negcache", "0", FROM_CONSOLE);
+        Cvar_SetEx("fs_index", (i & 1) ? "1" : "0", FROM_CONSOLE);
+        Cvar_SetEx("fs_negcache", (i & 2) ? "1" : "0", FROM_CONSOLE);
+
+        found = 0;
+        cold = warm = 0;
+        FS_BeginRegistration();
+        for (j = 0; j < passes; j++) {
+            start = Sys_Microseconds();
+            for (k = 0; k < count; k++) {
+                if (FS_LoadFileEx(names[k], NULL, modes[k], TAG_FREE) >= 0 && !j)
+                    found++;
+            }
+            if (j)
+                warm += Sys_Microseconds() - start;
+            else
+                cold = Sys_Microseconds() - start;
+        }
+        FS_EndRegistration();
+
+        Com_Printf("index %-3s negcache %-3s: %d lookups, %d found, %u usec first pass, "
+                   "%u usec average\n", (i & 1) ? "on" : "off", (i & 2) ? "on" : "off",
+                   count, found, (unsigned)cold, (unsigned)(warm / (passes - 1)));
+    }
+
+    Cvar_SetEx("fs_index", va("%d", index), FROM_CONSOLE);
+    Cvar_SetEx("fs_negcache", va("%d", negcache), FROM_CONSOLE);
+
+    Z_Free(names);
+    Z_Free(modes);
+    FS_FreeFile(data);
+}
+
+// checks that an error thrown during registration doesn't leave loose file
+// lookups cached. Throws ERR_DROP, then checks from the next command, so it
+// must be run from the console rather than the command line.
+static void Com_TestRegDrop_f(void)
+{
+    static const char name[] = "regtest.tmp";
+    char path[MAX_OSPATH];
+    qhandle_t f;
+    FILE *fp;
+    ssize_t ret;
+
+    if (Q_snprintf(path, sizeof(path), "%s/%s", fs_gamedir, name) >= sizeof(path)) {
+        Com_EPrintf("Oversize path\n");
+        return;
+    }
+
+    if (strcmp(Cmd_Argv(1), "check")) {
+        remove(path);
+
+        // cache the miss and the directory listing
+        FS_BeginRegistration();
+        ret = FS_FOpenFile(name, &f, FS_MODE_READ);
+        if (f) {
+            FS_FCloseFile(f);
+            FS_EndRegistration();
+            Com_EPrintf("Couldn't remove %s\n", name);
+            return;
+        }
+
+        Cbuf_AddText(&cmd_buffer, va("%s check\n", Cmd_Argv(0)));
+        Com_Error(ERR_DROP, "%s: aborting registration", Cmd_Argv(0));
+    }
+
+    // create the file behind the back of FS, so nothing invalidates
+    fp = fopen(path, "wb");
+    if (!fp) {
+        Com_EPrintf("Couldn't create %s\n", path);
+        return;
+    }
+    fputs("regtest\n", fp);
+    fclose(fp);
+
+    ret = FS_FOpenFile(name, &f, FS_MODE_READ);
+    if (f) {
+        FS_FCloseFile(f);
+        Com_Printf("%s: passed\n", Cmd_Argv(0));
+    } else {
+        Com_EPrintf("%s: new file not found after error: %s\n",
+                    Cmd_Argv(0), Q_ErrorString(ret));
+    }
+
+    remove(path);
+}
+
 #if USE_REF
+// registers every alias model in the game directory, models that are
+// already registered are not reloaded, so run this right after map change
 static void Com_TestModels_f(void)
 {
     void **list;
     int i, count, errors;
     unsigned start, end;
 
-    list = FS_ListFiles("models", ".md2", FS_SEARCH_SAVEPATH, &count);
+    list = FS_ListFiles(NULL, "*.md2;*.md3", FS_SEARCH_SAVEPATH | FS_SEARCH_BYFILTER, &count);
     if (!list) {
         Com_Printf("No models found\n");
         return;
@@ -524,6 +1078,76 @@ static void Com_TestModels_f(void)
 }
 #endif
 
+#if REF_VKPT
+// prebakes vkpt sidecars, run with +set dedicated 1 to skip the renderer
+static void Com_BakeMaps_f(void)
+{
+    void **list;
+    int i, count, errors;
+    qerror_t ret;
+    unsigned start, end;
+
+    list = FS_ListFiles("maps", ".bsp", FS_SEARCH_SAVEPATH, &count);
+    if (!list) {
+        Com_Printf("No maps found\n");
+        return;
+    }
+
+    start = Sys_Milliseconds();
+
+    errors = 0;
+    for (i = 0; i < count; i++) {
+        ret = R_BakeMap(list[i]);
+        if (ret) {
+            Com_EPrintf("%s: %s\n", (char *)list[i], Q_ErrorString(ret));
+            errors++;
+        }
+    }
+
+    end = Sys_Milliseconds();
+
+    Com_Printf("%d msec, %d failures, %d maps baked\n",
+               end - start, errors, count - errors);
+
+    FS_FreeList(list);
+}
+
+static void Com_TestMesh_f(void)
+{
+    void **list;
+    int i, count, errors, verts, indices;
+    qerror_t ret;
+    unsigned start, end;
+
+    list = FS_ListFiles("maps", ".bsp", FS_SEARCH_SAVEPATH, &count);
+    if (!list) {
+        Com_Printf("No maps found\n");
+        return;
+    }
+
+    start = Sys_Milliseconds();
+
+    errors = 0;
+    for (i = 0; i < count; i++) {
+        ret = R_TestMapMesh(list[i], &verts, &indices);
+        if (ret) {
+            Com_EPrintf("%s: %s\n", (char *)list[i], Q_ErrorString(ret));
+            errors++;
+            continue;
+        }
+
+        Com_Printf("%s: %d vertices, %d indices\n", (char *)list[i], verts, indices);
+    }
+
+    end = Sys_Milliseconds();
+
+    Com_Printf("%d msec, %d failures, %d maps tested\n",
+               end - start, errors, count);
+
+    FS_FreeList(list);
+}
+#endif
+
 void TST_Init(void)
 {
     Cmd_AddCommand("error", Com_Error_f);
@@ -532,12 +1156,26 @@ void TST_Init(void)
     Cmd_AddCommand("crash", Com_Crash_f);
     Cmd_AddCommand("printjunk", Com_PrintJunk_f);
     Cmd_AddCommand("bsptest", BSP_Test_f);
+    Cmd_AddCommand("visbench", BSP_BenchVis_f);
     Cmd_AddCommand("wildtest", Com_TestWild_f);
     Cmd_AddCommand("normtest", Com_TestNorm_f);
     Cmd_AddCommand("infotest", Com_TestInfo_f);
     Cmd_AddCommand("snprintftest", Com_TestSnprintf_f);
+    Cmd_AddCommand("writetest", Com_TestWrite_f);
+    Cmd_AddCommand("fsbench", Com_TestFs_f);
+    Cmd_AddCommand("regtest", Com_TestRegDrop_f);
+#if USE_CLIENT
+    Cmd_AddCommand("bitstest", Com_TestBits_f);
+#if USE_SNDDMA
+    Cmd_AddCommand("loopbench", Com_TestLoopSounds_f);
+#endif
+#endif
 #if USE_REF
     Cmd_AddCommand("modeltest", Com_TestModels_f);
 #endif
+#if REF_VKPT
+    Cmd_AddCommand("bakemaps", Com_BakeMaps_f);
+    Cmd_AddCommand("meshtest", Com_TestMesh_f);
+#endif
 }
 
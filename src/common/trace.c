@@ -0,0 +1,81 @@
+/*
+Copyright (C) 2003-2008 Andrey Nazarov
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+//
+// trace.c -- Chrome trace event format writer
+//
+
+#include "shared/shared.h"
+#include "common/files.h"
+#include "common/trace.h"
+
+/*
+==============================================================================
+
+TRACE WRITER
+
+Writes complete ("X") events with microsecond timestamps, one per line, in
+the JSON format chrome://tracing and Perfetto load. Every event belongs to
+process 1; tid selects the track it is drawn on.
+
+==============================================================================
+*/
+
+/*
+==================
+Com_TraceBegin
+
+Writes the header and names the first track.
+==================
+*/
+void Com_TraceBegin(qhandle_t f, int tid, const char *thread)
+{
+    FS_FPrintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    FS_FPrintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+               "\"args\":{\"name\":\"%s\"}}", tid, thread);
+}
+
+void Com_TraceThread(qhandle_t f, int tid, const char *thread)
+{
+    FS_FPrintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+               "\"args\":{\"name\":\"%s\"}}", tid, thread);
+}
+
+void Com_TraceEvent(qhandle_t f, const char *name, int tid,
+                    unsigned ts, unsigned dur, unsigned frame)
+{
+    FS_FPrintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+               "\"ts\":%u,\"dur\":%u,\"args\":{\"frame\":%u}}",
+               name, tid, ts, dur, frame);
+}
+
+/*
+==================
+Com_TraceEnd
+
+Finishes the trace and closes the file. Returns negative value
+if the final write failed.
+==================
+*/
+ssize_t Com_TraceEnd(qhandle_t f)
+{
+    ssize_t ret = FS_FPrintf(f, "\n]}\n");
+
+    FS_FCloseFile(f);
+    return ret;
+}
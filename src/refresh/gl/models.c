@@ -100,32 +100,10 @@ qerror_t MOD_LoadMD2(model_t *model, const void *rawdata, size_t length)
         return Q_ERR_TOO_FEW;
     }
 
-    for (i = 0; i < numindices; i++) {
-        remap[i] = 0xFFFF;
-    }
-
     // remap all triangle indices
-    numverts = 0;
     src_tc = (dmd2stvert_t *)((byte *)rawdata + header.ofs_st);
-    for (i = 0; i < numindices; i++) {
-        if (remap[i] != 0xFFFF) {
-            continue; // already remapped
-        }
-
-        for (j = i + 1; j < numindices; j++) {
-            if (vertIndices[i] == vertIndices[j] &&
-                (src_tc[tcIndices[i]].s == src_tc[tcIndices[j]].s &&
-                 src_tc[tcIndices[i]].t == src_tc[tcIndices[j]].t)) {
-                // duplicate vertex
-                remap[j] = i;
-                finalIndices[j] = numverts;
-            }
-        }
-
-        // new vertex
-        remap[i] = i;
-        finalIndices[i] = numverts++;
-    }
+    numverts = MOD_WeldMD2(vertIndices, tcIndices, src_tc, numindices,
+                           remap, finalIndices);
 
     if (numverts > TESS_MAX_VERTICES) {
         return Q_ERR_TOO_MANY;
@@ -94,23 +94,19 @@ static int aabb_overlap(vec3_t* aabbs, int i, int j) {
 		&& MAX(aabbs[2*i][2], aabbs[2*j][2]) <= MIN(aabbs[2*i+1][2], aabbs[2*j+1][2]);
 }
 
-static void cluster_vis_mask(bsp_t *bsp, byte mask[VIS_MAX_BYTES], int i, vec3_t* aabbs) {
+// bits is scratch space for visrowsize * 8 cluster numbers
+static void cluster_vis_mask(bsp_t *bsp, byte mask[VIS_MAX_BYTES], int i, vec3_t* aabbs, int *bits) {
 	byte imask[VIS_MAX_BYTES];
 	BSP_ClusterVis(bsp, imask, i, DVIS_PVS);
 	assert(Q_IsBitSet(imask, i));
-	memcpy(mask, imask, sizeof(imask));
+	memcpy(mask, imask, bsp->visrowsize);
 	// dilate
-	for (int j = 0; j < bsp->visrowsize; j++) {
-		if (imask[j]) {
-			for (int k = 0; k < 8; ++k) {
-				if (imask[j] & (1 << k) && aabb_overlap(aabbs, i, 8 * j + k)) {
-					byte jmask[VIS_MAX_BYTES];
-					BSP_ClusterVis(bsp, jmask, 8 * j + k, DVIS_PVS);
-					for (int l = 0; l < bsp->visrowsize; l++) {
-						mask[l] |= jmask[l];
-					}
-				}
-			}
+	int num_bits = BSP_VisBits(imask, bsp->visrowsize, bits);
+	for (int j = 0; j < num_bits; j++) {
+		if (aabb_overlap(aabbs, i, bits[j])) {
+			byte jmask[VIS_MAX_BYTES];
+			BSP_ClusterVis(bsp, jmask, bits[j], DVIS_PVS);
+			BSP_VisOr(mask, jmask, bsp->visrowsize);
 		}
 	}
 }
@@ -139,17 +135,22 @@ collect_light_clusters(bsp_mesh_t *wm, bsp_t *bsp)
 	return face_clusters;
 }
 
+/* light triangles grouped by the cluster they are in */
+typedef struct {
+	int num_lights;
+	int *counts;
+	int *offsets;
+	int *lights;
+	vec3_t *aabbs;
+} local_lights_t;
+
 static void
-collect_cluster_lights(bsp_mesh_t *wm, bsp_t *bsp)
+collect_local_lights(bsp_mesh_t *wm, local_lights_t *ll)
 {
-	int num_clusters = bsp->vis->numclusters; // bsp->visrowsize << 3;
-	int num_cluster_bytes = bsp->visrowsize;
-
-	wm->num_clusters = num_clusters;
-	wm->cluster_light_offsets = Z_Malloc((num_clusters+1) * sizeof(int));
+	int num_clusters = wm->num_clusters;
 
-	int *local_light_counts = Z_Malloc(num_clusters * sizeof(int));
-	memset(local_light_counts, 0, num_clusters * sizeof(int));
+	ll->counts = Z_Malloc(num_clusters * sizeof(int));
+	memset(ll->counts, 0, num_clusters * sizeof(int));
 
 	int num_tris = wm->num_indices/3;
 	for (int i = 0; i < num_tris; i++) {
@@ -158,86 +159,229 @@ collect_cluster_lights(bsp_mesh_t *wm, bsp_t *bsp)
 			if (cidx >= 0) {
 				cidx &= ~BSP_FLAG_LIGHT;
 				assert(cidx < num_clusters);
-				local_light_counts[cidx]++;
+				ll->counts[cidx]++;
 			}
 		}
 	}
 
-	int *local_light_offsets = Z_Malloc((num_clusters+1) * sizeof(int));
-	int num_cluster_lights = 0;
+	ll->offsets = Z_Malloc((num_clusters+1) * sizeof(int));
+	ll->num_lights = 0;
 	for (int i = 0; i < num_clusters; i++) {
-		local_light_offsets[i] = num_cluster_lights;
-		num_cluster_lights += local_light_counts[i];
+		ll->offsets[i] = ll->num_lights;
+		ll->num_lights += ll->counts[i];
 	}
-	local_light_offsets[num_clusters] = num_cluster_lights;
+	ll->offsets[num_clusters] = ll->num_lights;
 
-	int *local_cluster_lights = Z_Malloc(num_cluster_lights * sizeof(int));
+	ll->lights = Z_Malloc(ll->num_lights * sizeof(int));
 	for (int i = 0; i < num_tris; i++) {
 		if (wm->materials[i] & BSP_FLAG_LIGHT || wm->clusters[i] & BSP_FLAG_LIGHT) {
 			int cidx = wm->clusters[i];
 			if (cidx >= 0) {
 				cidx &= ~BSP_FLAG_LIGHT;
 				wm->clusters[i] = cidx; // flags no longer needed
-				local_cluster_lights[local_light_offsets[cidx]++] = i;
+				ll->lights[ll->offsets[cidx]++] = i;
 			}
 		}
 	}
+	for (int i = 0; i < num_clusters; i++) {
+		ll->offsets[i] -= ll->counts[i]; // reset after prev loop
+	}
 
 	// PVS seems slightly broken, try recovering by dilation step
 	// that requires AABBs of clusters!
-	vec3_t* aabbs = cluster_aabbs(wm, 8.f); // 8 taken from FatPVS
+	ll->aabbs = cluster_aabbs(wm, 8.f); // 8 taken from FatPVS
+}
+
+static void
+free_local_lights(local_lights_t *ll)
+{
+	Z_Free(ll->counts);
+	Z_Free(ll->offsets);
+	Z_Free(ll->lights);
+	Z_Free(ll->aabbs);
+}
+
+static uint32_t
+hash_light_list(const int *list, int count)
+{
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < count; i++)
+		hash = (hash ^ (uint32_t)list[i]) * 16777619u;
+	return hash;
+}
+
+// maps without vis put every leaf in cluster 0, which then sees all lights
+static void
+collect_novis_lights(bsp_mesh_t *wm)
+{
+	local_lights_t ll;
+
+	wm->num_clusters = 1;
+	wm->cluster_light_offsets = Z_Malloc(2 * sizeof(int));
+
+	collect_local_lights(wm, &ll);
+
+	wm->num_cluster_lights = ll.num_lights;
+	wm->cluster_lights = Z_Malloc(ll.num_lights * sizeof(int));
+	memcpy(wm->cluster_lights, ll.lights, ll.num_lights * sizeof(int));
+	wm->cluster_light_offsets[0] = 0;
+	wm->cluster_light_offsets[1] = ll.num_lights;
+
+	free_local_lights(&ll);
+}
+
+// the list of a cluster is the concatenation of the local lists of all
+// clusters in its dilated PVS. Neighbouring clusters tend to see the same
+// set, so each distinct list is stored once and cluster_light_offsets
+// holds a start and end pair per cluster pointing into the shared copy.
+static void
+collect_cluster_lights(bsp_mesh_t *wm, bsp_t *bsp)
+{
+	if (!bsp->vis) {
+		collect_novis_lights(wm);
+		return;
+	}
+
+	int num_clusters = bsp->vis->numclusters; // bsp->visrowsize << 3;
+	int num_cluster_bytes = bsp->visrowsize;
+	local_lights_t ll;
+
+	wm->num_clusters = num_clusters;
+	wm->cluster_light_offsets = Z_Malloc(num_clusters * 2 * sizeof(int));
+
+	collect_local_lights(wm, &ll);
+
+	// no list can hold a light twice
+	int *list = Z_Malloc(ll.num_lights * sizeof(int));
+	int *bits = Z_Malloc(num_cluster_bytes * 8 * sizeof(int));
+
+	int hash_size = npot32(num_clusters * 2);
+	int *hash = Z_Malloc(hash_size * sizeof(int));
+	memset(hash, -1, hash_size * sizeof(int));
+
+	int max_cluster_lights = ll.num_lights;
+	int num_cluster_lights = 0, num_expanded = 0;
+	wm->cluster_lights = Z_Malloc(max_cluster_lights * sizeof(int));
+
+	byte mask[VIS_MAX_BYTES];
+	for (int i = 0; i < num_clusters; i++) {
+		int count = 0;
+
+		cluster_vis_mask(bsp, mask, i, ll.aabbs, bits);
+		int num_bits = BSP_VisBits(mask, num_cluster_bytes, bits);
+		for (int j = 0; j < num_bits; j++) {
+			int ii = bits[j];
+			memcpy(list + count
+				, ll.lights + ll.offsets[ii]
+				, sizeof(int) * ll.counts[ii]);
+			count += ll.counts[ii];
+		}
+		num_expanded += count;
+
+		int slot = hash_light_list(list, count) & (hash_size - 1);
+		for (; hash[slot] >= 0; slot = (slot + 1) & (hash_size - 1)) {
+			int *other = wm->cluster_light_offsets + hash[slot] * 2;
+			if (other[1] - other[0] == count
+			&& !memcmp(wm->cluster_lights + other[0], list, count * sizeof(int)))
+				break;
+		}
+
+		if (hash[slot] >= 0) {
+			wm->cluster_light_offsets[i * 2 + 0] = wm->cluster_light_offsets[hash[slot] * 2 + 0];
+			wm->cluster_light_offsets[i * 2 + 1] = wm->cluster_light_offsets[hash[slot] * 2 + 1];
+			continue;
+		}
+
+		if (num_cluster_lights + count > max_cluster_lights) {
+			max_cluster_lights = MAX(max_cluster_lights * 2, num_cluster_lights + count);
+			wm->cluster_lights = Z_Realloc(wm->cluster_lights, max_cluster_lights * sizeof(int));
+		}
+
+		memcpy(wm->cluster_lights + num_cluster_lights, list, count * sizeof(int));
+		wm->cluster_light_offsets[i * 2 + 0] = num_cluster_lights;
+		num_cluster_lights += count;
+		wm->cluster_light_offsets[i * 2 + 1] = num_cluster_lights;
+		hash[slot] = i;
+	}
+
+	wm->num_cluster_lights = num_cluster_lights;
+	if (num_cluster_lights < max_cluster_lights)
+		wm->cluster_lights = Z_Realloc(wm->cluster_lights, num_cluster_lights * sizeof(int));
+
+	Com_DPrintf("%s: %d light list entries, %d without sharing\n",
+		__func__, num_cluster_lights, num_expanded);
+
+	Z_Free(list);
+	Z_Free(bits);
+	Z_Free(hash);
+	free_local_lights(&ll);
+}
+
+// builds the plain per cluster lists the way they were stored before
+// sharing and checks every cluster against its shared range, returns the
+// number of clusters that differ
+static int
+check_cluster_lights(bsp_mesh_t *wm, bsp_t *bsp)
+{
+	int num_clusters = wm->num_clusters;
+	int num_cluster_bytes = bsp->visrowsize;
+	local_lights_t ll;
+
+	collect_local_lights(wm, &ll);
 
 	int *cluster_light_counts = Z_Malloc(num_clusters * sizeof(int));
 	memset(cluster_light_counts, 0, num_clusters * sizeof(int));
+	int *bits = Z_Malloc(num_cluster_bytes * 8 * sizeof(int));
 
 	byte mask[VIS_MAX_BYTES];
 	for (int i = 0; i < num_clusters; i++) {
-		local_light_offsets[i] -= local_light_counts[i]; // reset after prev loop
-		cluster_vis_mask(bsp, mask, i, aabbs);
+		cluster_vis_mask(bsp, mask, i, ll.aabbs, bits);
 		for (int j = 0; j < num_cluster_bytes; j++) {
 			if (mask[j]) {
 				for (int k = 0; k < 8; ++k) {
 					if (mask[j] & (1 << k))
-						cluster_light_counts[i] += local_light_counts[j * 8 + k];
+						cluster_light_counts[i] += ll.counts[j * 8 + k];
 				}
 			}
 		}
 	}
 
-	num_cluster_lights = 0;
+	int *cluster_light_offsets = Z_Malloc((num_clusters+1) * sizeof(int));
+	int num_cluster_lights = 0;
 	for (int i = 0; i < num_clusters; i++) {
-		wm->cluster_light_offsets[i] = num_cluster_lights;
+		cluster_light_offsets[i] = num_cluster_lights;
 		num_cluster_lights += cluster_light_counts[i];
 	}
-	wm->cluster_light_offsets[num_clusters] = num_cluster_lights;
-
-	wm->num_cluster_lights = num_cluster_lights;
-	wm->cluster_lights = Z_Malloc(num_cluster_lights * sizeof(int));
+	cluster_light_offsets[num_clusters] = num_cluster_lights;
 
+	int *cluster_lights = Z_Malloc(num_cluster_lights * sizeof(int));
 	for (int i = 0; i < num_clusters; i++) {
-		cluster_vis_mask(bsp, mask, i, aabbs);
-		for (int j = 0; j < num_cluster_bytes; j++) {
-			if (mask[j]) {
-				for (int k = 0; k < 8; ++k) {
-					if (mask[j] & (1 << k)) {
-						int ii = j * 8 + k;
-						memcpy(wm->cluster_lights + wm->cluster_light_offsets[i]
-							, local_cluster_lights + local_light_offsets[ii]
-							, sizeof(int) * local_light_counts[ii]);
-						wm->cluster_light_offsets[i] += local_light_counts[ii];
-					}
-				}
+		int n = cluster_light_offsets[i];
+		cluster_vis_mask(bsp, mask, i, ll.aabbs, bits);
+		for (int j = 0; j < num_clusters; j++) {
+			if (Q_IsBitSet(mask, j)) {
+				for (int k = 0; k < ll.counts[j]; k++)
+					cluster_lights[n++] = ll.lights[ll.offsets[j] + k];
 			}
 		}
+		assert(n == cluster_light_offsets[i + 1]);
 	}
 
+	int failures = 0;
 	for (int i = 0; i < num_clusters; i++) {
-		wm->cluster_light_offsets[i] -= cluster_light_counts[i]; // reset after prev loop
+		int start = wm->cluster_light_offsets[i * 2 + 0];
+		int end   = wm->cluster_light_offsets[i * 2 + 1];
+		int count = cluster_light_counts[i];
+
+		if (start < 0 || end > wm->num_cluster_lights || end - start != count
+		|| memcmp(wm->cluster_lights + start, cluster_lights + cluster_light_offsets[i], count * sizeof(int)))
+			failures++;
 	}
 
-	Z_Free(local_light_counts);
-	Z_Free(local_light_offsets);
-	Z_Free(local_cluster_lights);
+	Z_Free(bits);
 	Z_Free(cluster_light_counts);
-	Z_Free(aabbs);
+	Z_Free(cluster_light_offsets);
+	Z_Free(cluster_lights);
+	free_local_lights(&ll);
+	return failures;
 }
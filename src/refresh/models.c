@@ -202,6 +202,61 @@ qerror_t MOD_ValidateMD2(dmd2header_t *header, size_t length)
     return Q_ERR_SUCCESS;
 }
 
+#define WELD_HASH_SIZE  0x8000  // power of two, over twice MD2_MAX_TRIANGLES * 3
+
+#if WELD_HASH_SIZE < MD2_MAX_TRIANGLES * 6
+#error WELD_HASH_SIZE
+#endif
+
+/*
+================
+MOD_WeldMD2
+
+Assigns output vertices to unique (xyz, st) pairs of triangle indices, in
+order of first use. For each index, remap receives the index of its first
+use and finalIndices the output vertex. Returns the number of vertices.
+================
+*/
+int MOD_WeldMD2(const uint16_t *vertIndices, const uint16_t *tcIndices,
+                const dmd2stvert_t *src_tc, int numindices,
+                uint16_t *remap, uint16_t *finalIndices)
+{
+    uint16_t    hash[WELD_HASH_SIZE];
+    unsigned    h;
+    int         i, j, numverts;
+
+    memset(hash, 0xff, sizeof(hash));
+
+    numverts = 0;
+    for (i = 0; i < numindices; i++) {
+        h = vertIndices[i] * 0x9E3779B1U ^
+            (uint16_t)src_tc[tcIndices[i]].s * 0x85EBCA77U ^
+            (uint16_t)src_tc[tcIndices[i]].t * 0xC2B2AE3DU;
+        h ^= h >> 15;
+
+        for (;; h++) {
+            j = hash[h & (WELD_HASH_SIZE - 1)];
+            if (j == 0xFFFF) {
+                // new vertex
+                hash[h & (WELD_HASH_SIZE - 1)] = i;
+                remap[i] = i;
+                finalIndices[i] = numverts++;
+                break;
+            }
+            if (vertIndices[i] == vertIndices[j] &&
+                (src_tc[tcIndices[i]].s == src_tc[tcIndices[j]].s &&
+                 src_tc[tcIndices[i]].t == src_tc[tcIndices[j]].t)) {
+                // duplicate vertex
+                remap[i] = j;
+                finalIndices[i] = finalIndices[j];
+                break;
+            }
+        }
+    }
+
+    return numverts;
+}
+
 static qerror_t MOD_LoadSP2(model_t *model, const void *rawdata, size_t length)
 {
     dsp2header_t header;
@@ -17,6 +17,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "vkpt.h"
+#include "common/mdfour.h"
 #include "shader/global_textures.h"
 
 #include <assert.h>
@@ -24,24 +25,62 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "../light_lists.c.h"
 
 static int
+texinfo_is_light(const mtexinfo_t *texinfo)
+{
+	if(texinfo->image)
+		return texinfo->image->is_light;
+
+	/* textures are not registered when baking without a renderer */
+	char buffer[MAX_QPATH];
+	Q_concat(buffer, sizeof(buffer), "textures/", texinfo->name, ".wal", NULL);
+	FS_NormalizePath(buffer, buffer);
+	return vkpt_is_light_texture(buffer);
+}
+
+/* faces are triangle fans, around their center if they have more than four
+ * edges. with weld set corners of a face share vertices, otherwise every
+ * triangle gets three vertices of its own */
+static void
+poly_size(const mface_t *surf, int weld, int *num_vertices, int *num_indices)
+{
+	int tess_center = surf->numsurfedges > 4;
+	int num_triangles = tess_center
+		? surf->numsurfedges
+		: surf->numsurfedges - 2;
+
+	*num_indices  = num_triangles * 3;
+	*num_vertices = weld ? surf->numsurfedges + tess_center : *num_indices;
+}
+
+/* texture coordinates are in texels and materials refer to texinfo
+ * until bsp_mesh_bind_textures, so the result only depends on the map */
+static void
 create_poly(
+	const bsp_t   *bsp,
 	const mface_t *surf,
+	int       weld,
+	int       base_vertex,
 	float    *positions_out,
 	float    *tex_coord_out,
+	int      *indices_out,
 	uint32_t *material_out)
 {
 	static const int max_vertices = 32;
-	float positions [3 * /*max_vertices*/ 32];
-	float tex_coords[2 * /*max_vertices*/ 32];
+	float positions [3 * /*max_vertices*/ 33];
+	float tex_coords[2 * /*max_vertices*/ 33];
 	mtexinfo_t *texinfo = surf->texinfo;
 	assert(surf->numsurfedges < max_vertices);
 	int flags = surf->drawflags;
 	flags |= (surf->texinfo ? surf->texinfo->c.flags : 0);
 	flags &= (surf->texinfo && surf->texinfo->radiance && !(flags & SURF_WARP) ? ~0 : ~SURF_LIGHT);
-	if(surf->texinfo && surf->texinfo->image->is_light)
+	if(surf->texinfo && texinfo_is_light(surf->texinfo))
 		flags |= SURF_LIGHT;
-	float sc[2] = { 1.0f / texinfo->image->width, 1.0f / texinfo->image->height };
 
+	/* switch between triangle fan around center or first vertex */
+	//int tess_center = 0;
+	int tess_center = surf->numsurfedges > 4;
+
+	/* local vertex 0 is the center, if there is one */
 	float pos_center[3] = { 0 };
 	float tc_center[2];
 
@@ -50,8 +89,8 @@ create_poly(
 		medge_t     *src_edge     = src_surfedge->edge;
 		mvertex_t   *src_vert     = src_edge->v[src_surfedge->vert];
 
-		float *p = positions + i * 3;
-		float *t = tex_coords + i * 2;
+		float *p = positions + (i + tess_center) * 3;
+		float *t = tex_coords + (i + tess_center) * 2;
 
 		VectorCopy(src_vert->point, p);
 
@@ -59,79 +98,57 @@ create_poly(
 		pos_center[1] += src_vert->point[1];
 		pos_center[2] += src_vert->point[2];
 
-		t[0] = (DotProduct(p, texinfo->axis[0]) + texinfo->offset[0]) * sc[0];
-		t[1] = (DotProduct(p, texinfo->axis[1]) + texinfo->offset[1]) * sc[1];
+		t[0] = DotProduct(p, texinfo->axis[0]) + texinfo->offset[0];
+		t[1] = DotProduct(p, texinfo->axis[1]) + texinfo->offset[1];
 	}
 
-	pos_center[0] /= (float)surf->numsurfedges;
-	pos_center[1] /= (float)surf->numsurfedges;
-	pos_center[2] /= (float)surf->numsurfedges;
-
-	tc_center[0] = (DotProduct(pos_center, texinfo->axis[0]) + texinfo->offset[0]) * sc[0];
-	tc_center[1] = (DotProduct(pos_center, texinfo->axis[1]) + texinfo->offset[1]) * sc[1];
-
-#define CP_V(idx, src) \
-    do { \
-        if(positions_out) { \
-            memcpy(positions_out + (idx) * 3, src, sizeof(float) * 3); \
-        } \
-    } while(0)
-
-#define CP_T(idx, src) \
-    do { \
-        if(tex_coord_out) { \
-            memcpy(tex_coord_out + (idx) * 2, src, sizeof(float) * 2); \
-        } \
-    } while(0)
-
-#define CP_M(idx) \
-    do { \
-        if(material_out) { \
-            material_out[k] = (int)(texinfo->image - r_images); \
-			if(flags & SURF_LIGHT)      material_out[k] |= BSP_FLAG_LIGHT; \
-			if(flags & SURF_WARP)       material_out[k] |= BSP_FLAG_WATER; \
-			if(flags & SURF_TRANS_MASK) material_out[k] |= BSP_FLAG_TRANSPARENT; \
-        } \
-    } while(0)
+	if (tess_center) {
+		pos_center[0] /= (float)surf->numsurfedges;
+		pos_center[1] /= (float)surf->numsurfedges;
+		pos_center[2] /= (float)surf->numsurfedges;
 
-	int k = 0;
-	/* switch between triangle fan around center or first vertex */
-	//int tess_center = 0;
-	int tess_center = surf->numsurfedges > 4;
+		tc_center[0] = DotProduct(pos_center, texinfo->axis[0]) + texinfo->offset[0];
+		tc_center[1] = DotProduct(pos_center, texinfo->axis[1]) + texinfo->offset[1];
 
-	const int num_triangles = tess_center
-		? surf->numsurfedges
-		: surf->numsurfedges - 2;
+		VectorCopy(pos_center, positions);
+		tex_coords[0] = tc_center[0];
+		tex_coords[1] = tc_center[1];
+	}
 
-	for (int i = 0; i < num_triangles; i++) {
-		const int e = surf->numsurfedges;
+	uint32_t material = (int)(texinfo - bsp->texinfo);
+	if(flags & SURF_LIGHT)      material |= BSP_FLAG_LIGHT;
+	if(flags & SURF_WARP)       material |= BSP_FLAG_WATER;
+	if(flags & SURF_TRANS_MASK) material |= BSP_FLAG_TRANSPARENT;
 
+	const int e = surf->numsurfedges;
+	const int num_triangles = tess_center ? e : e - 2;
+	int corners[3 * /*max_vertices*/ 32];
+
+	int k = 0;
+	for (int i = 0; i < num_triangles; i++) {
 		int i1 = (i + 2 - tess_center) % e;
 		int i2 = (i + 1 - tess_center) % e;
 
-		CP_V(k, tess_center ? pos_center : positions);
-		CP_T(k, tess_center ? tc_center : tex_coords);
-		CP_M(k);
-		k++;
-
-		CP_V(k, positions + i1 * 3);
-		CP_T(k, tex_coords + i1 * 2);
-		CP_M(k);
-		k++;
-
-		CP_V(k, positions + i2 * 3);
-		CP_T(k, tex_coords + i2 * 2);
-		CP_M(k);
-		k++;
+		corners[k++] = 0;
+		corners[k++] = i1 + tess_center;
+		corners[k++] = i2 + tess_center;
 
+		material_out[i] = material;
 	}
 
-#undef CP_V
-#undef CP_T
-#undef CP_M
+	if (weld) {
+		memcpy(positions_out, positions, (e + tess_center) * 3 * sizeof(float));
+		memcpy(tex_coord_out, tex_coords, (e + tess_center) * 2 * sizeof(float));
+		for (int i = 0; i < k; i++)
+			indices_out[i] = base_vertex + corners[i];
+		return;
+	}
 
-	assert(k % 3 == 0);
-	return k;
+	for (int i = 0; i < k; i++) {
+		memcpy(positions_out + i * 3, positions + corners[i] * 3, 3 * sizeof(float));
+		memcpy(tex_coord_out + i * 2, tex_coords + corners[i] * 2, 2 * sizeof(float));
+		indices_out[i] = base_vertex + i;
+	}
 }
 
 static int
@@ -145,13 +162,14 @@ belongs_to_model(bsp_t *bsp, mface_t *surf)
 	return 0;
 }
 
+/* with the mesh arrays not allocated yet, only counts vertices and indices */
 static void
-collect_surfaces(int *idx_ctr, bsp_mesh_t *wm, bsp_t *bsp, int model_idx, int skip_mask, int filter_mask)
+collect_surfaces(int *idx_ctr, int *vert_ctr, bsp_mesh_t *wm, bsp_t *bsp, int model_idx, int skip_mask, int filter_mask, int weld)
 {
 	mface_t *surfaces = model_idx < 0 ? bsp->faces : bsp->models[model_idx].firstface;
 	int num_faces = model_idx < 0 ? bsp->numfaces : bsp->models[model_idx].numfaces;
 
-	int *face_clusters = model_idx < 0 ? collect_light_clusters(wm, bsp) : NULL;
+	int *face_clusters = model_idx < 0 && wm->indices ? collect_light_clusters(wm, bsp) : NULL;
 
 	for (int i = 0; i < num_faces; i++) {
 		mface_t *surf = surfaces + i;
@@ -179,14 +197,16 @@ collect_surfaces(int *idx_ctr, bsp_mesh_t *wm, bsp_t *bsp, int model_idx, int sk
 			continue;
 		}
 
-		if (*idx_ctr + create_poly(surf, NULL, NULL, NULL) >= WM_MAX_VERTICES) {
-			Com_Error(ERR_FATAL, "error: exceeding max vertex limit\n");
-		}
+		int nv, cnt;
+		poly_size(surf, weld, &nv, &cnt);
 
-		int cnt = create_poly(surf,
-			&wm->positions[*idx_ctr * 3],
-			&wm->tex_coords[*idx_ctr * 2],
-			&wm->materials[*idx_ctr / 3]);
+		if (wm->indices) {
+			create_poly(bsp, surf, weld, *vert_ctr,
+				&wm->positions[*vert_ctr * 3],
+				&wm->tex_coords[*vert_ctr * 2],
+				&wm->indices[*idx_ctr],
+				&wm->materials[*idx_ctr / 3]);
+		}
 
 		if(face_clusters) {
 			for (int it = *idx_ctr / 3, k = 0; k < cnt; k += 3, ++it) {
@@ -194,69 +214,77 @@ collect_surfaces(int *idx_ctr, bsp_mesh_t *wm, bsp_t *bsp, int model_idx, int sk
 			}
 		}
 
+		*vert_ctr += nv;
 		*idx_ctr += cnt;
 	}
+
+	Z_Free(face_clusters);
 }
 
-void
-bsp_mesh_create_from_bsp(bsp_mesh_t *wm, bsp_t *bsp)
+static void
+collect_world(bsp_mesh_t *wm, bsp_t *bsp, int weld)
 {
-	wm->models_idx_offset = Z_Malloc(bsp->nummodels * sizeof(int));
-	wm->models_idx_count = Z_Malloc(bsp->nummodels * sizeof(int));
-	memset(wm->models_idx_offset, 0, bsp->nummodels * sizeof(int));
-	memset(wm->models_idx_count, 0, bsp->nummodels * sizeof(int));
-	wm->model_centers = Z_Malloc(bsp->nummodels * 3 * sizeof(float));
-
-	wm->num_models = bsp->nummodels;
-
-	wm->num_vertices  = 0;
-	wm->num_indices   = 0;
-	wm->positions     = Z_Malloc(WM_MAX_VERTICES * 3 * sizeof(*wm->positions));
-	wm->tex_coords    = Z_Malloc(WM_MAX_VERTICES * 2 * sizeof(*wm->tex_coords));
-	wm->materials     = Z_Malloc(WM_MAX_VERTICES / 3 * sizeof(*wm->materials));
-	wm->clusters      = Z_Malloc(WM_MAX_VERTICES / 3 * sizeof(*wm->clusters));
-
-	int idx_ctr = 0;
+	int idx_ctr = 0, vert_ctr = 0;
 
 	const int flags_static_world = SURF_NODRAW | SURF_SKY;
 
-	collect_surfaces(&idx_ctr, wm, bsp, -1, flags_static_world, 0);
+	collect_surfaces(&idx_ctr, &vert_ctr, wm, bsp, -1, flags_static_world, 0, weld);
 	wm->world_idx_count = idx_ctr;
 
 	wm->world_fluid_offset = idx_ctr;
-	collect_surfaces(&idx_ctr, wm, bsp, -1, 0, SURF_WARP);
+	collect_surfaces(&idx_ctr, &vert_ctr, wm, bsp, -1, 0, SURF_WARP, weld);
 	wm->world_fluid_count = idx_ctr - wm->world_fluid_offset;
 
 	wm->world_light_offset = idx_ctr;
-	collect_surfaces(&idx_ctr, wm, bsp, -1, flags_static_world, SURF_LIGHT);
+	collect_surfaces(&idx_ctr, &vert_ctr, wm, bsp, -1, flags_static_world, SURF_LIGHT, weld);
 	wm->world_light_count = idx_ctr - wm->world_light_offset;
 
 	for (int k = 0; k < bsp->nummodels; k++) {
 		wm->models_idx_offset[k] = idx_ctr;
-		collect_surfaces(&idx_ctr, wm, bsp, k, flags_static_world, 0);
+		collect_surfaces(&idx_ctr, &vert_ctr, wm, bsp, k, flags_static_world, 0, weld);
 		wm->models_idx_count[k] = idx_ctr - wm->models_idx_offset[k];
 	}
 
 	wm->num_indices = idx_ctr;
-	wm->num_vertices = idx_ctr;
+	wm->num_vertices = vert_ctr;
+}
+
+static void
+bsp_mesh_build(bsp_mesh_t *wm, bsp_t *bsp, int weld)
+{
+	wm->models_idx_offset = Z_Malloc(bsp->nummodels * sizeof(int));
+	wm->models_idx_count = Z_Malloc(bsp->nummodels * sizeof(int));
+	memset(wm->models_idx_offset, 0, bsp->nummodels * sizeof(int));
+	memset(wm->models_idx_count, 0, bsp->nummodels * sizeof(int));
+	wm->model_centers = Z_Malloc(bsp->nummodels * 3 * sizeof(float));
+
+	wm->num_models = bsp->nummodels;
 
-	wm->indices = Z_Malloc(idx_ctr * sizeof(int));
-	for (int i = 0; i < wm->num_vertices; i++)
-		wm->indices[i] = i;
+	/* count first, then fill buffers of exact size */
+	collect_world(wm, bsp, weld);
 
-	if (wm->num_vertices >= WM_MAX_VERTICES) {
+	if (wm->num_vertices >= WM_MAX_VERTICES || wm->num_indices >= WM_MAX_VERTICES) {
 		Com_Error(ERR_FATAL, "too many vertices\n");
 	}
 
+	wm->positions     = Z_Malloc(wm->num_vertices * 3 * sizeof(*wm->positions));
+	wm->tex_coords    = Z_Malloc(wm->num_vertices * 2 * sizeof(*wm->tex_coords));
+	wm->indices       = Z_Malloc(wm->num_indices * sizeof(*wm->indices));
+	wm->materials     = Z_Malloc(wm->num_indices / 3 * sizeof(*wm->materials));
+	wm->clusters      = Z_Malloc(wm->num_indices / 3 * sizeof(*wm->clusters));
+
+	collect_world(wm, bsp, weld);
+
 	for(int i = 0; i < wm->num_models; i++) {
 		vec3_t aabb_min = {  999999999.0f,  999999999.0f,  999999999.0f };
 		vec3_t aabb_max = { -999999999.0f, -999999999.0f, -999999999.0f };
 
 		for(int j = 0; j < wm->models_idx_count[i]; j++) {
 			vec3_t v;
-			v[0] = wm->positions[(wm->models_idx_offset[i] + j) * 3 + 0];
-			v[1] = wm->positions[(wm->models_idx_offset[i] + j) * 3 + 1];
-			v[2] = wm->positions[(wm->models_idx_offset[i] + j) * 3 + 2];
+			int idx = wm->indices[wm->models_idx_offset[i] + j];
+			v[0] = wm->positions[idx * 3 + 0];
+			v[1] = wm->positions[idx * 3 + 1];
+			v[2] = wm->positions[idx * 3 + 2];
 
 			aabb_min[0] = MIN(aabb_min[0], v[0]);
 			aabb_min[1] = MIN(aabb_min[1], v[1]);
@@ -273,16 +301,16 @@ bsp_mesh_create_from_bsp(bsp_mesh_t *wm, bsp_t *bsp)
 	}
 
 	//FILE *f = fopen("/tmp/lights", "a+");
-	for(int i = 0; i < wm->num_indices; i++) {
+	for(int i = 0; i < wm->num_indices / 3; i++) {
 		uint32_t m = wm->materials[i];
 		m &= BSP_TEXTURE_MASK;
 
-		if(m >= MAX_RIMAGES)
+		if(m >= bsp->numtexinfo)
 			continue;
 
-		if(r_images[m].is_light)
+		if(texinfo_is_light(&bsp->texinfo[m]))
 			wm->materials[i] |= BSP_FLAG_LIGHT;
-		//fprintf(f, "%s\n", r_images[m].name);
+		//fprintf(f, "%s\n", bsp->texinfo[m].name);
 
 	}
 	//fclose(f);
@@ -290,20 +318,448 @@ bsp_mesh_create_from_bsp(bsp_mesh_t *wm, bsp_t *bsp)
 	collect_cluster_lights(wm, bsp);
 }
 
+/*
+ * Baked map data
+ *
+ * Everything bsp_mesh_build derives from the map is cached in a sidecar
+ * file named after the full map path and checked against the map checksum,
+ * BAKE_VERSION and the set of light textures. Later loads map the file and
+ * use the arrays in place, only texture coordinates and materials are
+ * copied to bind them to images.
+ * Bump BAKE_VERSION whenever bsp_mesh_build output changes.
+ */
+
+#define BAKE_IDENT      MakeRawLong('V', 'K', 'B', 'M')
+#define BAKE_VERSION    4
+
+#define BAKE_NOVIS      1   /* built without vis, a single cluster */
+
+typedef struct {
+	uint32_t ident;
+	uint32_t version;
+	uint32_t checksum;          /* bsp->checksum */
+	uint32_t lights;            /* bake_light_signature */
+	uint32_t flags;             /* BAKE_NOVIS */
+	uint32_t num_texinfo;
+	uint32_t num_models;
+	uint32_t num_vertices;
+	uint32_t num_indices;
+	uint32_t num_clusters;
+	uint32_t num_cluster_lights;
+	uint32_t world_idx_count;
+	uint32_t world_fluid_offset;
+	uint32_t world_fluid_count;
+	uint32_t world_light_offset;
+	uint32_t world_light_count;
+	uint32_t size;              /* of the whole file */
+} bake_header_t;
+
+/* arrays follow the header in this order, all made of 32 bit values */
+#define BAKE_ARRAYS(h) \
+	BAKE_DO(models_idx_offset,     (h)->num_models) \
+	BAKE_DO(models_idx_count,      (h)->num_models) \
+	BAKE_DO(model_centers,         (h)->num_models * 3) \
+	BAKE_DO(positions,             (h)->num_vertices * 3) \
+	BAKE_DO(tex_coords,            (h)->num_vertices * 2) \
+	BAKE_DO(indices,               (h)->num_indices) \
+	BAKE_DO(materials,             (h)->num_indices / 3) \
+	BAKE_DO(clusters,              (h)->num_indices / 3) \
+	BAKE_DO(cluster_light_offsets, (h)->num_clusters * 2) \
+	BAKE_DO(cluster_lights,        (h)->num_cluster_lights)
+
+static cvar_t *vkpt_map_bake;
+
+/* write failures are reported once, the gamedir is likely read-only */
+static qboolean bake_write_warned;
+
+static qboolean
+bake_path(char *buffer, size_t size, const bsp_t *bsp)
+{
+	char name[MAX_QPATH];
+
+	COM_StripExtension(bsp->name, name, sizeof(name));
+	return Q_concat(buffer, size, "cache/vkpt/", name, ".bin", NULL) < size;
+}
+
+/* which texinfos are lights depends on textures found, not only the map */
+static uint32_t
+bake_light_signature(const bsp_t *bsp)
+{
+	byte *lights = Z_Malloc(bsp->numtexinfo + 1);
+
+	for(int i = 0; i < bsp->numtexinfo; i++)
+		lights[i] = texinfo_is_light(&bsp->texinfo[i]);
+
+	uint32_t sig = Com_BlockChecksum(lights, bsp->numtexinfo);
+	Z_Free(lights);
+	return sig;
+}
+
+static size_t
+bake_size(const bake_header_t *h)
+{
+	size_t size = sizeof(*h);
+#define BAKE_DO(name, count) size += (size_t)(count) * sizeof(uint32_t);
+	BAKE_ARRAYS(h)
+#undef BAKE_DO
+	return size;
+}
+
+static void
+bake_header(bake_header_t *h, const bsp_mesh_t *wm, const bsp_t *bsp)
+{
+	memset(h, 0, sizeof(*h));
+	h->ident              = BAKE_IDENT;
+	h->version            = BAKE_VERSION;
+	h->checksum           = bsp->checksum;
+	h->lights             = bake_light_signature(bsp);
+	h->flags              = bsp->vis ? 0 : BAKE_NOVIS;
+	h->num_texinfo        = bsp->numtexinfo;
+	h->num_models         = wm->num_models;
+	h->num_vertices       = wm->num_vertices;
+	h->num_indices        = wm->num_indices;
+	h->num_clusters       = wm->num_clusters;
+	h->num_cluster_lights = wm->num_cluster_lights;
+	h->world_idx_count    = wm->world_idx_count;
+	h->world_fluid_offset = wm->world_fluid_offset;
+	h->world_fluid_count  = wm->world_fluid_count;
+	h->world_light_offset = wm->world_light_offset;
+	h->world_light_count  = wm->world_light_count;
+	h->size               = bake_size(h);
+}
+
+static qboolean
+bake_range_ok(uint32_t offset, uint32_t count, uint32_t total)
+{
+	return offset <= total && count <= total - offset;
+}
+
+/* everything indexed at runtime must be in range, the file may be stale or
+ * corrupt and is trusted no further than the map itself */
+static qboolean
+bake_validate(const bake_header_t *h, const bsp_mesh_t *wm)
+{
+	uint32_t num_tris = h->num_indices / 3;
+
+	if(h->num_indices % 3)
+		return qfalse;
+	if(!bake_range_ok(0, h->world_idx_count, h->num_indices)
+	|| !bake_range_ok(h->world_fluid_offset, h->world_fluid_count, h->num_indices)
+	|| !bake_range_ok(h->world_light_offset, h->world_light_count, h->num_indices))
+		return qfalse;
+
+	for(int i = 0; i < h->num_models; i++) {
+		if(!bake_range_ok(wm->models_idx_offset[i], wm->models_idx_count[i], h->num_indices))
+			return qfalse;
+	}
+
+	for(int i = 0; i < h->num_indices; i++) {
+		if(wm->indices[i] < 0 || wm->indices[i] >= h->num_vertices)
+			return qfalse;
+	}
+
+	for(int i = 0; i < num_tris; i++) {
+		if((wm->materials[i] & BSP_TEXTURE_MASK) >= h->num_texinfo)
+			return qfalse;
+		if(wm->clusters[i] < -1 || wm->clusters[i] >= (int)h->num_clusters)
+			return qfalse;
+	}
+
+	for(int i = 0; i < h->num_clusters; i++) {
+		int start = wm->cluster_light_offsets[i * 2 + 0];
+		int end   = wm->cluster_light_offsets[i * 2 + 1];
+		if(start < 0 || start > end || end > h->num_cluster_lights)
+			return qfalse;
+	}
+	for(int i = 0; i < h->num_cluster_lights; i++) {
+		if(wm->cluster_lights[i] < 0 || wm->cluster_lights[i] >= num_tris)
+			return qfalse;
+	}
+
+	return qtrue;
+}
+
+static qboolean
+bsp_mesh_load_baked(bsp_mesh_t *wm, bsp_t *bsp)
+{
+	char path[MAX_QPATH];
+	const bake_header_t *h;
+	void *baked;
+	ssize_t len;
+
+	if(!bake_path(path, sizeof(path), bsp))
+		return qfalse;
+	len = FS_MapFile(path, (const void **)&h, &baked);
+	if(!baked)
+		return qfalse;
+
+	if(len < sizeof(*h)
+	|| h->ident != BAKE_IDENT
+	|| h->version != BAKE_VERSION
+	|| h->checksum != bsp->checksum
+	|| h->num_texinfo != bsp->numtexinfo
+	|| h->num_models != bsp->nummodels
+	|| h->flags != (bsp->vis ? 0 : BAKE_NOVIS)
+	|| h->num_clusters != (bsp->vis ? bsp->vis->numclusters : 1)
+	|| h->num_vertices >= WM_MAX_VERTICES
+	|| h->num_indices >= WM_MAX_VERTICES
+	|| h->num_cluster_lights >= WM_MAX_VERTICES
+	|| h->lights != bake_light_signature(bsp))
+		goto stale;
+
+	/* counts are bounded above, so the size can't overflow */
+	if(h->size != bake_size(h) || len < h->size)
+		goto stale;
+
+	memset(wm, 0, sizeof(*wm));
+
+	const uint32_t *p = (const uint32_t *)(h + 1);
+#define BAKE_DO(name, count) \
+	wm->name = (void *)p; \
+	p += (count);
+	BAKE_ARRAYS(h)
+#undef BAKE_DO
+
+	if(!bake_validate(h, wm))
+		goto stale;
+
+	wm->num_models         = h->num_models;
+	wm->num_vertices       = h->num_vertices;
+	wm->num_indices        = h->num_indices;
+	wm->num_clusters       = h->num_clusters;
+	wm->num_cluster_lights = h->num_cluster_lights;
+	wm->world_idx_count    = h->world_idx_count;
+	wm->world_fluid_offset = h->world_fluid_offset;
+	wm->world_fluid_count  = h->world_fluid_count;
+	wm->world_light_offset = h->world_light_offset;
+	wm->world_light_count  = h->world_light_count;
+
+	/* these get bound to images, everything else is used in place */
+	float *tex_coords = Z_Malloc(wm->num_vertices * 2 * sizeof(float));
+	memcpy(tex_coords, wm->tex_coords, wm->num_vertices * 2 * sizeof(float));
+	wm->tex_coords = tex_coords;
+
+	uint32_t *materials = Z_Malloc(wm->num_indices / 3 * sizeof(uint32_t));
+	memcpy(materials, wm->materials, wm->num_indices / 3 * sizeof(uint32_t));
+	wm->materials = materials;
+
+	wm->baked = baked;
+	return qtrue;
+
+stale:
+	Com_DPrintf("%s: %s is stale\n", __func__, path);
+	memset(wm, 0, sizeof(*wm));
+	FS_UnmapFile(baked);
+	return qfalse;
+}
+
+static qerror_t
+bsp_mesh_save_baked(const bsp_mesh_t *wm, const bsp_t *bsp)
+{
+	char path[MAX_QPATH];
+	bake_header_t h;
+	byte *buf, *p;
+	qerror_t ret;
+
+	if(!bake_path(path, sizeof(path), bsp))
+		return Q_ERR_NAMETOOLONG;
+
+	bake_header(&h, wm, bsp);
+
+	buf = Z_Malloc(h.size);
+	memcpy(buf, &h, sizeof(h));
+	p = buf + sizeof(h);
+#define BAKE_DO(name, count) \
+	memcpy(p, wm->name, (size_t)(count) * sizeof(uint32_t)); \
+	p += (size_t)(count) * sizeof(uint32_t);
+	BAKE_ARRAYS(&h)
+#undef BAKE_DO
+
+	ret = FS_WriteFile(path, buf, h.size);
+	Z_Free(buf);
+
+	if(ret && !bake_write_warned) {
+		Com_WPrintf("Couldn't write %s: %s\n", path, Q_ErrorString(ret));
+		bake_write_warned = qtrue;
+	} else if(ret) {
+		Com_DPrintf("Couldn't write %s: %s\n", path, Q_ErrorString(ret));
+	}
+	return ret;
+}
+
+/* resolve texinfo references from the baked data to registered images */
+static void
+bsp_mesh_bind_textures(bsp_mesh_t *wm, bsp_t *bsp)
+{
+	/* vertices are shared by triangles of the same face only */
+	byte *scaled = Z_Mallocz(wm->num_vertices);
+
+	for(int i = 0; i < wm->num_indices / 3; i++) {
+		uint32_t m = wm->materials[i];
+		mtexinfo_t *texinfo = &bsp->texinfo[m & BSP_TEXTURE_MASK];
+		image_t *image = texinfo->image;
+		float sc[2] = { 1.0f / image->width, 1.0f / image->height };
+
+		wm->materials[i] = (m & ~BSP_TEXTURE_MASK) | (int)(image - r_images);
+
+		for(int j = i * 3; j < i * 3 + 3; j++) {
+			int idx = wm->indices[j];
+			if(scaled[idx])
+				continue;
+			wm->tex_coords[idx * 2 + 0] *= sc[0];
+			wm->tex_coords[idx * 2 + 1] *= sc[1];
+			scaled[idx] = 1;
+		}
+	}
+
+	Z_Free(scaled);
+}
+
 void
-bsp_mesh_destroy(bsp_mesh_t *wm)
+bsp_mesh_create_from_bsp(bsp_mesh_t *wm, bsp_t *bsp)
 {
-	Z_Free(wm->models_idx_offset);
-	Z_Free(wm->models_idx_count);
-	Z_Free(wm->model_centers);
+	if(!vkpt_map_bake->integer || !bsp_mesh_load_baked(wm, bsp)) {
+		bsp_mesh_build(wm, bsp, 1);
+		if(vkpt_map_bake->integer)
+			bsp_mesh_save_baked(wm, bsp);
+	}
 
-	Z_Free(wm->positions);
+	bsp_mesh_bind_textures(wm, bsp);
+}
+
+void
+bsp_mesh_destroy(bsp_mesh_t *wm)
+{
 	Z_Free(wm->tex_coords);
-	Z_Free(wm->indices);
+	Z_Free(wm->materials);
+
+	if(wm->baked) {
+		FS_UnmapFile(wm->baked);
+	} else {
+		Z_Free(wm->models_idx_offset);
+		Z_Free(wm->models_idx_count);
+		Z_Free(wm->model_centers);
+
+		Z_Free(wm->positions);
+		Z_Free(wm->indices);
+		Z_Free(wm->clusters);
+		Z_Free(wm->cluster_light_offsets);
+		Z_Free(wm->cluster_lights);
+	}
 
 	memset(wm, 0, sizeof(*wm));
 }
 
+/*
+==================
+R_BakeMap
+
+Writes baked data for the map without textures or a renderer, so that
+sidecars can be prebaked on a headless machine.
+==================
+*/
+qerror_t
+R_BakeMap(const char *name)
+{
+	bsp_mesh_t wm;
+	bsp_t *bsp;
+	qerror_t ret;
+
+	ret = BSP_Load(name, &bsp);
+	if(!bsp)
+		return ret;
+
+	memset(&wm, 0, sizeof(wm));
+	bsp_mesh_build(&wm, bsp, 1);
+	ret = bsp_mesh_save_baked(&wm, bsp);
+	bsp_mesh_destroy(&wm);
+
+	BSP_Free(bsp);
+	return ret;
+}
+
+static qboolean
+corners_equal(const bsp_mesh_t *a, const bsp_mesh_t *b, int i)
+{
+	int ia = a->indices[i], ib = b->indices[i];
+
+	return !memcmp(&a->positions[ia * 3], &b->positions[ib * 3], 3 * sizeof(float))
+		&& !memcmp(&a->tex_coords[ia * 2], &b->tex_coords[ib * 2], 2 * sizeof(float));
+}
+
+/*
+==================
+R_TestMapMesh
+
+Builds the world mesh with and without welding vertices and checks that
+both describe the same triangles, in the same order and with the same
+attributes. Shared light lists are checked against plain per cluster ones.
+Needs no renderer.
+==================
+*/
+qerror_t
+R_TestMapMesh(const char *name, int *num_vertices, int *num_indices)
+{
+	bsp_mesh_t welded, soup;
+	bsp_t *bsp;
+	qerror_t ret;
+
+	ret = BSP_Load(name, &bsp);
+	if(!bsp)
+		return ret;
+
+	if(!bsp->vis) {
+		BSP_Free(bsp);
+		return Q_ERR_INVALID_FORMAT;
+	}
+
+	memset(&welded, 0, sizeof(welded));
+	memset(&soup, 0, sizeof(soup));
+	bsp_mesh_build(&welded, bsp, 1);
+	bsp_mesh_build(&soup, bsp, 0);
+
+	ret = Q_ERR_SUCCESS;
+	if(welded.num_indices != soup.num_indices
+	|| welded.world_idx_count != soup.world_idx_count
+	|| welded.world_fluid_offset != soup.world_fluid_offset
+	|| welded.world_fluid_count != soup.world_fluid_count
+	|| welded.world_light_offset != soup.world_light_offset
+	|| welded.world_light_count != soup.world_light_count
+	|| welded.num_cluster_lights != soup.num_cluster_lights
+	|| memcmp(welded.models_idx_offset, soup.models_idx_offset, bsp->nummodels * sizeof(uint32_t))
+	|| memcmp(welded.models_idx_count, soup.models_idx_count, bsp->nummodels * sizeof(uint32_t))
+	|| memcmp(welded.model_centers, soup.model_centers, bsp->nummodels * sizeof(vec3_t))
+	|| memcmp(welded.materials, soup.materials, soup.num_indices / 3 * sizeof(uint32_t))
+	|| memcmp(welded.clusters, soup.clusters, soup.num_indices / 3 * sizeof(int))
+	|| memcmp(welded.cluster_light_offsets, soup.cluster_light_offsets, soup.num_clusters * 2 * sizeof(int))
+	|| memcmp(welded.cluster_lights, soup.cluster_lights, soup.num_cluster_lights * sizeof(int))) {
+		ret = Q_ERR_FAILURE;
+	}
+
+	if(check_cluster_lights(&welded, bsp))
+		ret = Q_ERR_FAILURE;
+
+	for(int i = 0; i < soup.num_indices && !ret; i++) {
+		if(welded.indices[i] < 0 || welded.indices[i] >= welded.num_vertices
+		|| !corners_equal(&welded, &soup, i))
+			ret = Q_ERR_FAILURE;
+	}
+
+	*num_vertices = welded.num_vertices;
+	*num_indices = welded.num_indices;
+
+	bsp_mesh_destroy(&welded);
+	bsp_mesh_destroy(&soup);
+	BSP_Free(bsp);
+	return ret;
+}
+
+void
+bsp_mesh_init(void)
+{
+	vkpt_map_bake = Cvar_Get("vkpt_map_bake", "1", 0);
+}
+
 void
 bsp_mesh_register_textures(bsp_t *bsp)
 {
@@ -1080,7 +1080,7 @@ update_lights()
 					ent_is_light |= 1;
 					for(int k = 0; k < 3; k++) {
 						float tmp[4];
-						memcpy(tmp, bsp->positions + (idx_off + j * 3 + k) * 3, 3 * sizeof(float));
+						memcpy(tmp, bsp->positions + bsp->indices[idx_off + j * 3 + k] * 3, 3 * sizeof(float));
 						tmp[3] = 1.0;
 						mult_matrix_vector(light_pos, M, tmp);
 						light_pos += 3;
@@ -1203,7 +1203,9 @@ R_RenderFrame(refdef_t *fd)
 
 	uint32_t num_vert_instanced;
 	uint32_t num_instances;
+	CL_PROF_START(CL_PROF_TRANSFORMS);
 	upload_entity_transforms(&num_instances, &num_vert_instanced);
+	CL_PROF_STOP(CL_PROF_TRANSFORMS);
 
 	float P[16];
 	float V[16];
@@ -1226,7 +1228,11 @@ R_RenderFrame(refdef_t *fd)
 	ubo->time = fd->time;
 	memcpy(ubo->cam_pos, fd->vieworg, sizeof(float) * 3);
 
+	CL_PROF_START(CL_PROF_UNIFORMS);
 	_VK(vkpt_uniform_buffer_update());
+	CL_PROF_STOP(CL_PROF_UNIFORMS);
+
+	CL_PROF_START(CL_PROF_RECORD);
 
 	_VK(vkpt_profiler_query(PROFILER_INSTANCE_GEOMETRY, PROFILER_START));
 	vkpt_vertex_buffer_create_instance(num_instances);
@@ -1305,6 +1311,8 @@ R_RenderFrame(refdef_t *fd)
 			.oldLayout        = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			.newLayout        = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
 	);
+
+	CL_PROF_STOP(CL_PROF_RECORD);
 }
 
 static void
@@ -1325,6 +1333,7 @@ R_BeginFrame()
 retry:;
 	int sem_idx = qvk.frame_counter % MAX_FRAMES_IN_FLIGHT;
 
+	CL_PROF_START(CL_PROF_WAIT);
 	vkWaitForFences(qvk.device, 1, qvk.fences_frame_sync + sem_idx, VK_TRUE, ~((uint64_t) 0));
 	VkResult res_swapchain = vkAcquireNextImageKHR(qvk.device, qvk.swap_chain, ~((uint64_t) 0),
 			qvk.semaphores[SEM_IMG_AVAILABLE + sem_idx], VK_NULL_HANDLE, &qvk.current_image_index);
@@ -1336,6 +1345,7 @@ retry:;
 		_VK(res_swapchain);
 	}
 	vkResetFences(qvk.device, 1, qvk.fences_frame_sync + sem_idx);
+	CL_PROF_STOP(CL_PROF_WAIT);
 
 	_VK(vkpt_profiler_next_frame(qvk.current_image_index));
 
@@ -1389,6 +1399,7 @@ R_EndFrame()
 		.pCommandBuffers      = &qvk.cmd_buf_current,
 	};
 
+	CL_PROF_START(CL_PROF_SUBMIT);
 	_VK(vkQueueSubmit(qvk.queue_graphics, 1, &submit_info, qvk.fences_frame_sync[sem_idx]));
 
 	VkPresentInfoKHR present_info = {
@@ -1402,6 +1413,7 @@ R_EndFrame()
 	};
 
 	VkResult res_present = vkQueuePresentKHR(qvk.queue_graphics, &present_info);
+	CL_PROF_STOP(CL_PROF_SUBMIT);
 	if(res_present == VK_ERROR_OUT_OF_DATE_KHR || res_present == VK_SUBOPTIMAL_KHR) {
 		recreate_swapchain();
 	}
@@ -1457,6 +1469,7 @@ R_Init(qboolean total)
 	vkpt_profiler       = Cvar_Get("vkpt_profiler",       "0",    0);
 	vkpt_reconstruction = Cvar_Get("vkpt_reconstruction", "1",    0);
 	cvar_rtx            = Cvar_Get("rtx",                 "off",  0);
+	bsp_mesh_init();
 
 	qvk.win_width  = r_config.width;
 	qvk.win_height = r_config.height;
@@ -1601,7 +1614,8 @@ R_BeginRegistration(const char *name)
 
 	_VK(vkpt_pt_destroy_static());
 	const bsp_mesh_t *m = &vkpt_refdef.bsp_mesh_world;
-	_VK(vkpt_pt_create_static(qvk.buf_vertex.buffer, offsetof(VertexBuffer, positions_bsp), m->world_idx_count));
+	_VK(vkpt_pt_create_static(qvk.buf_vertex.buffer, offsetof(VertexBuffer, positions_bsp), m->num_vertices,
+				offsetof(VertexBuffer, idx_bsp), m->world_idx_count));
 
 	{
 		int num_prims = 0;
@@ -66,6 +66,7 @@ qerror_t MOD_LoadMD2(model_t *model, const void *rawdata, size_t length)
 	uint16_t        vertIndices[TESS_MAX_INDICES];
 	uint16_t        tcIndices[TESS_MAX_INDICES];
 	uint16_t        finalIndices[TESS_MAX_INDICES];
+	uint16_t        firstIndices[TESS_MAX_INDICES];
 	int             numverts, numindices;
 	char            skinname[MAX_QPATH];
 	vec_t           scale_s, scale_t;
@@ -122,31 +123,15 @@ qerror_t MOD_LoadMD2(model_t *model, const void *rawdata, size_t length)
 		return Q_ERR_TOO_FEW;
 	}
 
-	for (int i = 0; i < numindices; i++) {
-		remap[i] = 0xFFFF;
-	}
-
 	// remap all triangle indices
-	numverts = 0;
 	src_tc = (dmd2stvert_t *)((byte *)rawdata + header.ofs_st);
-	for (int i = 0; i < numindices; i++) {
-		if (remap[i] != 0xFFFF) {
-			continue; // already remapped
-		}
-
-		for (int j = i + 1; j < numindices; j++) {
-			if (vertIndices[i] == vertIndices[j] &&
-					(src_tc[tcIndices[i]].s == src_tc[tcIndices[j]].s &&
-					 src_tc[tcIndices[i]].t == src_tc[tcIndices[j]].t)) {
-				// duplicate vertex
-				remap[j] = i;
-				finalIndices[j] = numverts;
-			}
-		}
+	numverts = MOD_WeldMD2(vertIndices, tcIndices, src_tc, numindices,
+			remap, finalIndices);
 
-		// new vertex
-		remap[i] = i;
-		finalIndices[i] = numverts++;
+	// first use of each vertex, in output order
+	for (int i = 0; i < numindices; i++) {
+		if (remap[i] == i)
+			firstIndices[finalIndices[i]] = i;
 	}
 
 	Hunk_Begin(&model->hunk, 50u<<20);
@@ -187,10 +172,17 @@ qerror_t MOD_LoadMD2(model_t *model, const void *rawdata, size_t length)
 		src_skin += MD2_MAX_SKINNAME;
 	}
 
-	// load all tcoords
+	// load all tcoords, they are the same for every frame
 	src_tc = (dmd2stvert_t *)((byte *)rawdata + header.ofs_st);
 	scale_s = 1.0f / header.skinwidth;
 	scale_t = 1.0f / header.skinheight;
+	for (int i = 0; i < numverts; i++) {
+		dst_mesh->tex_coords[i][0] = scale_s * src_tc[tcIndices[firstIndices[i]]].s;
+		dst_mesh->tex_coords[i][1] = scale_t * src_tc[tcIndices[firstIndices[i]]].t;
+	}
+	for (int j = 1; j < header.num_frames; j++) {
+		memcpy(dst_mesh->tex_coords + j * numverts, dst_mesh->tex_coords, numverts * sizeof(vec2_t));
+	}
 
 	// load all frames
 	src_frame = (dmd2frame_t *)((byte *)rawdata + header.ofs_frames);
@@ -201,31 +193,20 @@ qerror_t MOD_LoadMD2(model_t *model, const void *rawdata, size_t length)
 
 		// load frame vertices
 		ClearBounds(mins, maxs);
-		for (int i = 0; i < numindices; i++) {
-			if (remap[i] != i) {
-				continue;
-			}
-			src_vert = &src_frame->verts[vertIndices[i]];
-			vec3_t *dst_pos = &dst_mesh->positions [j * numverts + finalIndices[i]];
-			vec3_t *dst_nrm = &dst_mesh->normals   [j * numverts + finalIndices[i]];
-			vec2_t *dst_tc  = &dst_mesh->tex_coords[j * numverts + finalIndices[i]];
-
-			(*dst_tc)[0] = scale_s * src_tc[tcIndices[i]].s;
-			(*dst_tc)[1] = scale_t * src_tc[tcIndices[i]].t;
+		vec3_t *dst_pos = &dst_mesh->positions[j * numverts];
+		vec3_t *dst_nrm = &dst_mesh->normals  [j * numverts];
+		for (int i = 0; i < numverts; i++, dst_pos++, dst_nrm++) {
+			src_vert = &src_frame->verts[vertIndices[firstIndices[i]]];
 
 			(*dst_pos)[0] = src_vert->v[0] * dst_frame->scale[0] + dst_frame->translate[0];
 			(*dst_pos)[1] = src_vert->v[1] * dst_frame->scale[1] + dst_frame->translate[1];
 			(*dst_pos)[2] = src_vert->v[2] * dst_frame->scale[2] + dst_frame->translate[2];
 
-			(*dst_nrm)[0] = 0.0f;
-			(*dst_nrm)[1] = 0.0f;
-			(*dst_nrm)[2] = 0.0f;
-
 			val = src_vert->lightnormalindex;
 			if (val < NUMVERTEXNORMALS) {
-				(*dst_nrm)[0] = bytedirs[val][0];
-				(*dst_nrm)[1] = bytedirs[val][1];
-				(*dst_nrm)[2] = bytedirs[val][2];
+				VectorCopy(bytedirs[val], *dst_nrm);
+			} else {
+				VectorClear(*dst_nrm);
 			}
 
 			for (int k = 0; k < 3; k++) {
@@ -207,8 +207,9 @@ get_scratch_buffer_size(VkAccelerationStructureNV ac)
 	return mem_req.memoryRequirements.size;
 }
 
+/* without indices, every three vertices make a triangle */
 static inline VkGeometryNV
-get_geometry(VkBuffer buffer, size_t offset, uint32_t num_vertices) 
+get_geometry(VkBuffer buffer, size_t offset, uint32_t num_vertices, size_t index_offset, uint32_t num_indices)
 {
 	size_t size_per_vertex = sizeof(float) * 3;
 	VkGeometryNV geometry = {
@@ -227,6 +228,12 @@ get_geometry(VkBuffer buffer, size_t offset, uint32_t num_vertices)
 			.aabbs = { .sType = VK_STRUCTURE_TYPE_GEOMETRY_AABB_NV }
 		}
 	};
+	if(num_indices) {
+		geometry.geometry.triangles.indexData   = buffer;
+		geometry.geometry.triangles.indexOffset = index_offset;
+		geometry.geometry.triangles.indexCount  = num_indices;
+		geometry.geometry.triangles.indexType   = VK_INDEX_TYPE_UINT32;
+	}
 	return geometry;
 }
 
@@ -263,6 +270,8 @@ vkpt_pt_create_accel_bottom(
 		VkBuffer vertex_buffer,
 		size_t buffer_offset,
 		int num_vertices,
+		size_t index_offset,
+		int num_indices,
 		VkAccelerationStructureNV *accel,
 		VkDeviceMemory *mem_accel,
 		VkCommandBuffer cmd_buf
@@ -273,7 +282,8 @@ vkpt_pt_create_accel_bottom(
 	assert(mem_accel);
 	assert(!*mem_accel);
 
-	VkGeometryNV geometry = get_geometry(vertex_buffer, buffer_offset, num_vertices);
+	VkGeometryNV geometry = get_geometry(vertex_buffer, buffer_offset, num_vertices,
+			index_offset, num_indices);
 
 	VkAccelerationStructureCreateInfoNV accel_create_info = {
 		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_NV,
@@ -341,7 +351,9 @@ VkResult
 vkpt_pt_create_static(
 		VkBuffer vertex_buffer,
 		size_t buffer_offset,
-		int num_vertices
+		int num_vertices,
+		size_t index_offset,
+		int num_indices
 		)
 {
 	VkCommandBufferAllocateInfo cmd_buf_info = {
@@ -365,6 +377,8 @@ vkpt_pt_create_static(
 		vertex_buffer,
 		buffer_offset,
 		num_vertices,
+		index_offset,
+		num_indices,
 		&accel_static,
 		&mem_accel_static,
 		cmd_buf);
@@ -397,6 +411,7 @@ vkpt_pt_create_dynamic(
 		vertex_buffer,
 		buffer_offset,
 		num_vertices,
+		0, 0,
 		accel_dynamic + idx,
 		mem_accel_dynamic + idx,
 		qvk.cmd_buf_current);
@@ -21,6 +21,22 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 static VkQueryPool query_pool;
 static uint64_t query_pool_results[NUM_PROFILER_QUERIES_PER_FRAME];
 
+/* client frame and CPU time at which each swapchain image's queries were
+ * submitted, used to place GPU timings on the CPU trace timeline */
+static unsigned query_frame[MAX_SWAPCHAIN_IMAGES];
+static uint64_t query_submit[MAX_SWAPCHAIN_IMAGES];
+
+static char query_names[NUM_PROFILER_ENTRIES][64];
+
+static void
+get_query_name(char *buf, int size, const char *enum_name)
+{
+	int i;
+	for(i = 0; i < size - 1 && enum_name[i]; i++)
+		buf[i] = enum_name[i] == '_' ? ' ' : tolower(enum_name[i]);
+	buf[i] = 0;
+}
+
 VkResult
 vkpt_profiler_initialize()
 {
@@ -30,6 +46,13 @@ vkpt_profiler_initialize()
 		.queryCount = MAX_SWAPCHAIN_IMAGES * NUM_PROFILER_ENTRIES * 2,
 	};
 	vkCreateQueryPool(qvk.device, &query_pool_info, NULL, &query_pool);
+
+#define PROFILER_DO(name, indent) \
+	get_query_name(query_names[name], sizeof(query_names[name]), #name + 9);
+PROFILER_LIST
+#undef PROFILER_DO
+
+	memset(query_frame, 0, sizeof(query_frame));
 	return VK_SUCCESS;
 }
 
@@ -43,6 +66,12 @@ vkpt_profiler_destroy()
 VkResult
 vkpt_profiler_query(int idx, VKPTProfilerAction action)
 {
+	/* the frame query ends right before the command buffer is submitted */
+	if(idx == PROFILER_FRAME_TIME && action == PROFILER_STOP) {
+		query_frame[qvk.current_image_index] = CL_ProfFrame();
+		query_submit[qvk.current_image_index] = Sys_Microseconds();
+	}
+
 	idx = idx * 2 + action + qvk.current_image_index * NUM_PROFILER_QUERIES_PER_FRAME;
 	vkCmdWriteTimestamp(qvk.cmd_buf_current, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
 			query_pool, idx);
@@ -68,6 +97,21 @@ vkpt_profiler_next_frame(int frame_num)
 			NUM_PROFILER_QUERIES_PER_FRAME);
 			*/
 
+	/* GPU work starts no earlier than submission, align frame start to it */
+	if(cl_prof_active && query_frame[frame_num]) {
+		uint64_t frame_start = query_pool_results[PROFILER_FRAME_TIME * 2];
+		for(int i = 0; i < NUM_PROFILER_ENTRIES; i++) {
+			uint64_t start = query_pool_results[i * 2];
+			uint64_t stop  = query_pool_results[i * 2 + 1];
+			if(stop < start || start < frame_start)
+				continue;
+			CL_ProfGpuEvent(query_frame[frame_num], query_names[i],
+					query_submit[frame_num] + (start - frame_start) / 1000,
+					(stop - start) / 1000);
+		}
+		query_frame[frame_num] = 0;
+	}
+
 	//Com_Printf("%ld %ld\n", query_pool_results[0], query_pool_results[1]);
 
 	//double ms = (double) (query_pool_results[1] - query_pool_results[0]) * 1e-6;
@@ -77,20 +121,22 @@ vkpt_profiler_next_frame(int frame_num)
 }
 
 static void
-draw_query(int x, int y, qhandle_t font, const char *enum_name, int idx)
+draw_row(int x, int y, qhandle_t font, const char *name, double ms)
 {
 	char buf[256];
-	int i;
-	for(i = 0; i < LENGTH(buf) - 1 && enum_name[i]; i++)
-		buf[i] = enum_name[i] == '_' ? ' ' : tolower(enum_name[i]); 
-	buf[i] = 0;
 
-	R_DrawString(x, y, 0, 128, buf, font);
-	double ms = (double) (query_pool_results[idx * 2 + 1] - query_pool_results[idx * 2 + 0]) * 1e-6;
+	R_DrawString(x, y, 0, 128, name, font);
 	snprintf(buf, sizeof buf, "%8.2f ms", ms);
 	R_DrawString(x + 256, y, 0, 128, buf, font);
 }
 
+static void
+draw_query(int x, int y, qhandle_t font, int idx)
+{
+	double ms = (double) (query_pool_results[idx * 2 + 1] - query_pool_results[idx * 2 + 0]) * 1e-6;
+	draw_row(x, y, font, query_names[idx], ms);
+}
+
 void
 draw_profiler()
 {
@@ -103,7 +149,19 @@ draw_profiler()
 		return;
 
 #define PROFILER_DO(name, indent) \
-	draw_query(x, y, font, #name + 9, name); y += 10;
+	draw_query(x, y, font, name); y += 10;
 PROFILER_LIST
 #undef PROFILER_DO
+
+	if(!cl_prof_active)
+		return;
+
+	/* CPU scopes of the last finished client frame, see cl_profile */
+	y += 10;
+	for(int i = 0; i < CL_PROF_NUM_SCOPES; i++) {
+		char buf[64];
+		snprintf(buf, sizeof buf, "cpu %s", CL_ProfName(i));
+		draw_row(x, y, font, buf, CL_ProfLastMsec(i));
+		y += 10;
+	}
 }
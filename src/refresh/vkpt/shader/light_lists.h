@@ -100,8 +100,9 @@ sample_light_list(
 		return;
 	pdf = 1.0;
 
-	uint list_start = get_light_list_offsets(list_idx);
-	uint list_end   = get_light_list_offsets(list_idx + 1);
+	/* lists are shared between clusters, each has its own start and end */
+	uint list_start = get_light_list_offsets(list_idx * 2);
+	uint list_end   = get_light_list_offsets(list_idx * 2 + 1);
 
 //#define NO_IS
 #ifdef NO_IS
@@ -150,10 +151,7 @@ sample_light_list(
 		
 		uint current_idx = get_light_list_lights(n_idx);
 
-		mat3 positions = mat3x3(
-				get_positions_bsp(current_idx * 3 + 0),
-				get_positions_bsp(current_idx * 3 + 1),
-				get_positions_bsp(current_idx * 3 + 2));
+		mat3 positions = get_bsp_triangle_positions(current_idx);
 
 		float m = projected_tri_area(positions, p, n, V);
 		mass += m;
@@ -177,10 +175,7 @@ sample_light_list(
 #if 0
 		
 		current_idx = int(get_light_list_lights(n_idx));
-		mat3 positions = mat3x3(
-				get_positions_bsp(current_idx * 3 + 0),
-				get_positions_bsp(current_idx * 3 + 1),
-				get_positions_bsp(current_idx * 3 + 2));
+		mat3 positions = get_bsp_triangle_positions(uint(current_idx));
 		pdf = projected_tri_area(positions, p, n, V);
 #else
 		pdf = light_masses[i];
@@ -199,10 +194,7 @@ sample_light_list(
 	// assert: current_idx >= 0?
 	if (current_idx >= 0) {
 		current_idx = int(get_light_list_lights(current_idx));
-		mat3 positions = mat3x3(
-				get_positions_bsp(current_idx * 3 + 0),
-				get_positions_bsp(current_idx * 3 + 1),
-				get_positions_bsp(current_idx * 3 + 2));
+		mat3 positions = get_bsp_triangle_positions(uint(current_idx));
 #if SOLID_ANGLE_SAMPLING
 		position_light = sample_projected_triangle(p, positions, rng.yz, normal_light, pdf);
 #else
@@ -17,7 +17,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 
-#define MAX_VERT_BSP            (1 << 21)
+/* welded world meshes typically need under 1.5 vertices per triangle */
+#define MAX_VERT_BSP            (1 << 20)
+#define MAX_IDX_BSP             ((1 << 21) / 3)
 
 #define MAX_VERT_MODEL          (1 << 21)
 #define MAX_IDX_MODEL           (1 << 21)
@@ -25,7 +27,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define MAX_VERT_INSTANCED      (1 << 21)
 #define MAX_IDX_INSTANCED       (MAX_VERT_INSTANCED / 3)
 
-#define MAX_LIGHT_LISTS         (1 << 14)
+#define MAX_LIGHT_LISTS         (1 << 15)
 #define MAX_LIGHT_LIST_NODES    (1 << 20)
 
 #define ALIGN_SIZE_4(x, n)  ((x * n + 3) & (~3))
@@ -39,8 +41,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #define VERTEX_BUFFER_LIST \
 	VERTEX_BUFFER_LIST_DO(float,    3, positions_bsp,         (MAX_VERT_BSP        )) \
 	VERTEX_BUFFER_LIST_DO(float,    2, tex_coords_bsp,        (MAX_VERT_BSP        )) \
-	VERTEX_BUFFER_LIST_DO(uint32_t, 1, materials_bsp,         (MAX_VERT_BSP / 3    )) \
-	VERTEX_BUFFER_LIST_DO(uint32_t, 1, clusters_bsp,          (MAX_VERT_BSP / 3    )) \
+	VERTEX_BUFFER_LIST_DO(uint32_t, 3, idx_bsp,               (MAX_IDX_BSP         )) \
+	VERTEX_BUFFER_LIST_DO(uint32_t, 1, materials_bsp,         (MAX_IDX_BSP         )) \
+	VERTEX_BUFFER_LIST_DO(uint32_t, 1, clusters_bsp,          (MAX_IDX_BSP         )) \
 	\
 	VERTEX_BUFFER_LIST_DO(float,    3, positions_model,       (MAX_VERT_MODEL      )) \
 	VERTEX_BUFFER_LIST_DO(float,    3, normals_model,         (MAX_VERT_MODEL      )) \
@@ -163,13 +166,26 @@ struct InstancedTriangle
 	uint   material_id;
 };
 
+mat3
+get_bsp_triangle_positions(uint prim_id)
+{
+	uvec3 idx = get_idx_bsp(prim_id);
+
+	return mat3x3(
+		get_positions_bsp(idx[0]),
+		get_positions_bsp(idx[1]),
+		get_positions_bsp(idx[2]));
+}
+
 Triangle
 get_bsp_triangle(uint prim_id)
 {
+	uvec3 idx = get_idx_bsp(prim_id);
+
 	Triangle t;
-	t.positions[0] = get_positions_bsp(prim_id * 3 + 0);
-	t.positions[1] = get_positions_bsp(prim_id * 3 + 1);
-	t.positions[2] = get_positions_bsp(prim_id * 3 + 2);
+	t.positions[0] = get_positions_bsp(idx[0]);
+	t.positions[1] = get_positions_bsp(idx[1]);
+	t.positions[2] = get_positions_bsp(idx[2]);
 
 	vec3 normal = normalize(cross(
 				t.positions[1] - t.positions[0],
@@ -179,9 +195,9 @@ get_bsp_triangle(uint prim_id)
 	t.normals[1] = normal;
 	t.normals[2] = normal;
 
-	t.tex_coords[0] = get_tex_coords_bsp(prim_id * 3 + 0);
-	t.tex_coords[1] = get_tex_coords_bsp(prim_id * 3 + 1);
-	t.tex_coords[2] = get_tex_coords_bsp(prim_id * 3 + 2);
+	t.tex_coords[0] = get_tex_coords_bsp(idx[0]);
+	t.tex_coords[1] = get_tex_coords_bsp(idx[1]);
+	t.tex_coords[2] = get_tex_coords_bsp(idx[2]);
 
 	t.material_id = get_materials_bsp(prim_id);
 
@@ -473,6 +473,16 @@ static const char *light_texture_names[] = {
 	"textures/e3u1/brlava.tga",
 };
 
+int
+vkpt_is_light_texture(const char *name)
+{
+	for(int i = 0; i < LENGTH(light_texture_names); i++) {
+		if(!strncmp(name, light_texture_names[i], strlen(light_texture_names[i]) - 4))
+			return 1;
+	}
+	return 0;
+}
+
 void
 IMG_Load(image_t *image, byte *pic)
 {
@@ -480,13 +490,7 @@ IMG_Load(image_t *image, byte *pic)
 	int w = image->upload_width;
 	int h = image->upload_height;
 
-	image->is_light = 0;
-	for(int i = 0; i < LENGTH(light_texture_names); i++) {
-		if(!strncmp(image->name, light_texture_names[i], strlen(light_texture_names[i]) - 4)) {
-			image->is_light = 1;
-			break;
-		}
-	}
+	image->is_light = vkpt_is_light_texture(image->name);
 
 	//int num_mip_levels = log2(MAX(w, h));
 	image->pix_data = Z_Malloc(w * h * 4 * 2);
@@ -27,9 +27,33 @@ static VkDescriptorPool desc_pool_vertex_buffer;
 static VkPipeline       pipeline_instance_geometry;
 static VkPipelineLayout pipeline_layout_instance_geometry;
 
+#define MAX_STAGING_REGIONS 16
+
+/* ranges of the staging buffer written since the last upload */
+static VkBufferCopy staging_regions[MAX_STAGING_REGIONS];
+static uint32_t     num_staging_regions;
+
+static void
+staging_region(VertexBuffer *vbo, const void *dst, size_t size)
+{
+	if(!size)
+		return;
+
+	assert(num_staging_regions < MAX_STAGING_REGIONS);
+	VkDeviceSize offset = (const char *) dst - (const char *) vbo;
+	staging_regions[num_staging_regions++] = (VkBufferCopy) {
+		.srcOffset = offset,
+		.dstOffset = offset,
+		.size      = size,
+	};
+}
+
 VkResult
 vkpt_vertex_buffer_upload_staging()
 {
+	if(!num_staging_regions)
+		return VK_SUCCESS;
+
 	vkDeviceWaitIdle(qvk.device);
 	assert(!qvk.buf_vertex_staging.is_mapped);
 	VkCommandBufferAllocateInfo cmd_alloc = {
@@ -47,10 +71,9 @@ vkpt_vertex_buffer_upload_staging()
 	};
 	vkBeginCommandBuffer(cmd_buf, &cmd_begin_info);
 
-	VkBufferCopy copyRegion = {
-		.size = sizeof(VertexBuffer),
-	};
-	vkCmdCopyBuffer(cmd_buf, qvk.buf_vertex_staging.buffer, qvk.buf_vertex.buffer, 1, &copyRegion);
+	vkCmdCopyBuffer(cmd_buf, qvk.buf_vertex_staging.buffer, qvk.buf_vertex.buffer,
+		num_staging_regions, staging_regions);
+	num_staging_regions = 0;
 	
 	vkEndCommandBuffer(cmd_buf);
 	VkSubmitInfo submit_info = {
@@ -70,21 +93,42 @@ VkResult
 vkpt_vertex_buffer_upload_bsp_mesh_to_staging(bsp_mesh_t *bsp_mesh)
 {
 	assert(bsp_mesh);
+
+	if(bsp_mesh->num_vertices >= MAX_VERT_BSP || bsp_mesh->num_indices / 3 >= MAX_IDX_BSP)
+		Com_Error(ERR_DROP, "%s: world mesh too large: %d vertices, %d triangles",
+			__func__, bsp_mesh->num_vertices, bsp_mesh->num_indices / 3);
+
 	VertexBuffer *vbo = (VertexBuffer *) buffer_map(&qvk.buf_vertex_staging);
 	assert(vbo);
 
-	assert(bsp_mesh->num_vertices < MAX_VERT_BSP);
+	size_t pos_size = bsp_mesh->num_vertices * sizeof(float) * 3;
+	size_t tc_size  = bsp_mesh->num_vertices * sizeof(float) * 2;
+	size_t idx_size = bsp_mesh->num_indices  * sizeof(uint32_t);
+	size_t tri_size = bsp_mesh->num_indices  * sizeof(uint32_t) / 3;
+
+	memcpy(vbo->positions_bsp,  bsp_mesh->positions, pos_size);
+	memcpy(vbo->tex_coords_bsp, bsp_mesh->tex_coords,tc_size );
+	memcpy(vbo->idx_bsp,        bsp_mesh->indices,   idx_size);
+	memcpy(vbo->materials_bsp,  bsp_mesh->materials, tri_size);
+	memcpy(vbo->clusters_bsp,   bsp_mesh->clusters,  tri_size);
 
-	memcpy(vbo->positions_bsp,  bsp_mesh->positions, bsp_mesh->num_vertices * sizeof(float) * 3   );
-	memcpy(vbo->tex_coords_bsp, bsp_mesh->tex_coords,bsp_mesh->num_vertices * sizeof(float) * 2   );
-	memcpy(vbo->materials_bsp,  bsp_mesh->materials, bsp_mesh->num_vertices * sizeof(uint32_t) / 3);
-	memcpy(vbo->clusters_bsp,   bsp_mesh->clusters,  bsp_mesh->num_vertices * sizeof(uint32_t) / 3);
+	staging_region(vbo, vbo->positions_bsp,  pos_size);
+	staging_region(vbo, vbo->tex_coords_bsp, tc_size );
+	staging_region(vbo, vbo->idx_bsp,        idx_size);
+	staging_region(vbo, vbo->materials_bsp,  tri_size);
+	staging_region(vbo, vbo->clusters_bsp,   tri_size);
 
-	assert(bsp_mesh->num_clusters + 1   < MAX_LIGHT_LISTS);
+	assert(bsp_mesh->num_clusters * 2   <= MAX_LIGHT_LISTS);
 	assert(bsp_mesh->num_cluster_lights < MAX_LIGHT_LIST_NODES);
 
-	memcpy(vbo->light_list_offsets, bsp_mesh->cluster_light_offsets, (bsp_mesh->num_clusters + 1) * sizeof(uint32_t));
-	memcpy(vbo->light_list_lights,  bsp_mesh->cluster_lights,        bsp_mesh->num_cluster_lights * sizeof(uint32_t));
+	size_t offsets_size = bsp_mesh->num_clusters * 2 * sizeof(uint32_t);
+	size_t lights_size  = bsp_mesh->num_cluster_lights * sizeof(uint32_t);
+
+	memcpy(vbo->light_list_offsets, bsp_mesh->cluster_light_offsets, offsets_size);
+	memcpy(vbo->light_list_lights,  bsp_mesh->cluster_lights,        lights_size );
+
+	staging_region(vbo, vbo->light_list_offsets, offsets_size);
+	staging_region(vbo, vbo->light_list_lights,  lights_size );
 
 	buffer_unmap(&qvk.buf_vertex_staging);
 	vbo = NULL;
@@ -159,6 +203,11 @@ vkpt_vertex_buffer_upload_models_to_staging()
 		assert(idx_offset < MAX_IDX_MODEL);
 	}
 
+	staging_region(vbo, vbo->positions_model,  sizeof(float)    * 3 * vertex_offset);
+	staging_region(vbo, vbo->normals_model,    sizeof(float)    * 3 * vertex_offset);
+	staging_region(vbo, vbo->tex_coords_model, sizeof(float)    * 2 * vertex_offset);
+	staging_region(vbo, vbo->idx_model,        sizeof(uint32_t) * idx_offset);
+
 	buffer_unmap(&qvk.buf_vertex_staging);
 	vbo = NULL;
 
@@ -38,6 +38,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "refresh/images.h"
 #include "refresh/models.h"
 #include "system/hunk.h"
+#include "system/system.h"
 
 #include "shader/global_ubo.h"
 #include "shader/global_textures.h"
@@ -230,10 +231,13 @@ typedef struct bsp_mesh_s {
 	int *clusters;
 
 	int num_cluster_lights;
-	int *cluster_light_offsets;
+	int *cluster_light_offsets; /* start and end per cluster, lists may be shared */
 	int *cluster_lights;
+
+	void *baked; /* mapped sidecar backing the read-only arrays, if any */
 } bsp_mesh_t;
 
+void bsp_mesh_init(void);
 void bsp_mesh_create_from_bsp(bsp_mesh_t *wm, bsp_t *bsp);
 void bsp_mesh_destroy(bsp_mesh_t *wm);
 void bsp_mesh_register_textures(bsp_t *bsp);
@@ -306,6 +310,7 @@ VkResult vkpt_textures_initialize();
 VkResult vkpt_textures_destroy();
 VkResult vkpt_textures_end_registration();
 VkResult vkpt_textures_upload_envmap(int w, int h, byte *data);
+int vkpt_is_light_texture(const char *name);
 
 VkResult vkpt_draw_initialize();
 VkResult vkpt_draw_destroy();
@@ -343,7 +348,7 @@ VkResult vkpt_pt_create_pipelines();
 VkResult vkpt_pt_destroy_pipelines();
 
 VkResult vkpt_pt_create_toplevel(int idx);
-VkResult vkpt_pt_create_static(VkBuffer vertex_buffer, size_t buffer_offset, int num_vertices);
+VkResult vkpt_pt_create_static(VkBuffer vertex_buffer, size_t buffer_offset, int num_vertices, size_t index_offset, int num_indices);
 VkResult vkpt_pt_destroy_static();
 VkResult vkpt_pt_record_cmd_buffer(VkCommandBuffer cmd_buf, uint32_t frame_num);
 VkResult vkpt_pt_update_descripter_set_bindings(int idx);
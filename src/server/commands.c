@@ -427,6 +427,35 @@ static void SV_Map_c(genctx_t *ctx, int argnum)
     }
 }
 
+/*
+==================
+SV_PreloadMap_f
+
+Starts loading a map in the background, for map rotation scripts that
+know better than the next map guessed from the entity string.
+==================
+*/
+static void SV_PreloadMap_f(void)
+{
+    char name[MAX_QPATH];
+    qerror_t ret;
+
+    if (Cmd_Argc() != 2) {
+        Com_Printf("Usage: %s <mapname>\n", Cmd_Argv(0));
+        return;
+    }
+
+    if (Q_concat(name, sizeof(name), "maps/", Cmd_Argv(1), ".bsp", NULL) >= sizeof(name)) {
+        Com_Printf("Oversize map name.\n");
+        return;
+    }
+
+    ret = BSP_Preload(name);
+    if (ret) {
+        Com_Printf("Couldn't preload %s: %s\n", name, Q_ErrorString(ret));
+    }
+}
+
 static void SV_DumpEnts_f(void)
 {
     bsp_t *c = sv.cm.cache;
@@ -1545,6 +1574,7 @@ static const cmdreg_t c_server[] = {
     { "map", SV_Map_f, SV_Map_c },
     { "demomap", SV_DemoMap_f },
     { "gamemap", SV_GameMap_f, SV_Map_c },
+    { "preloadmap", SV_PreloadMap_f, SV_Map_c },
     { "dumpents", SV_DumpEnts_f },
     { "setmaster", SV_SetMaster_f },
     { "listmasters", SV_ListMasters_f },
@@ -1567,6 +1597,11 @@ static const cmdreg_t c_server[] = {
     { "mvdrecord", SV_Record_f, SV_Record_c },
     { "mvdstop", SV_Stop_f },
 #endif
+#if USE_TESTS
+    { "loadgen", SV_Loadgen_f },
+    { "loadgen_stop", SV_LoadgenStop_f },
+    { "loadgen_stats", SV_LoadgenStats_f },
+#endif
 
     { NULL }
 };
@@ -370,6 +370,28 @@ fix_old_origin(client_t *client, entity_packed_t *state, edict_t *ent, int e)
 }
 #endif
 
+/*
+=============
+SV_PackedEntity
+
+Quantizes entity state at most once per server frame for each angle
+precision. Game state doesn't change between building client frames
+and MVD frame, so the result can be shared.
+=============
+*/
+const entity_packed_t *SV_PackedEntity(edict_t *ent, int e, qboolean short_angles)
+{
+    server_entity_t *sent = &sv.entities[e];
+    int i = !!short_angles;
+
+    if (sent->packedframe[i] != sv.framenum + 1) {
+        MSG_PackEntity(&sent->packed[i], &ent->s, short_angles);
+        sent->packedframe[i] = sv.framenum + 1;
+    }
+
+    return &sent->packed[i];
+}
+
 /*
 =============
 SV_BuildClientFrame
@@ -506,7 +528,10 @@ void SV_BuildClientFrame(client_t *client)
 
         // add it to the circular client_entities array
         state = &svs.entities[svs.next_entity % svs.num_entities];
-        MSG_PackEntity(state, &ent->s, Q2PRO_SHORTANGLES(client, e));
+        if (sv.state == ss_game)
+            *state = *SV_PackedEntity(ent, e, Q2PRO_SHORTANGLES(client, e));
+        else
+            MSG_PackEntity(state, &ent->s, qfalse);
 
 #if USE_FPS
         // fix old entity origins for clients not running at
@@ -127,6 +127,60 @@ fail1:
                 buffer, Q_ErrorString(len));
 }
 
+// guesses the map that follows from worldspawn "nextmap" or the first
+// target_changelevel, the way deathmatch rotation in the game does
+static qboolean guess_next_map(const char *data, char *buffer, size_t size)
+{
+    char classname[MAX_QPATH];
+    char map[MAX_QPATH];
+    char key[MAX_TOKEN_CHARS];
+    char *p, *s;
+
+    map[0] = 0;
+    while (data && !map[0]) {
+        p = COM_Parse(&data);
+        if (p[0] != '{') {
+            break;
+        }
+
+        classname[0] = 0;
+        while (data) {
+            p = COM_Parse(&data);
+            if (p[0] == '}' || !data) {
+                break;
+            }
+            Q_strlcpy(key, p, sizeof(key));
+
+            p = COM_Parse(&data);
+            if (!strcmp(key, "classname")) {
+                Q_strlcpy(classname, p, sizeof(classname));
+            } else if (!strcmp(key, "nextmap") || !strcmp(key, "map")) {
+                Q_strlcpy(map, p, sizeof(map));
+            }
+        }
+
+        if (strcmp(classname, "worldspawn") && strcmp(classname, "target_changelevel")) {
+            map[0] = 0;
+        }
+    }
+
+    // strip unit marker, cinematics before the map and spawnpoint after it
+    s = map;
+    if (*s == '*') {
+        s++;
+    }
+    if ((p = strrchr(s, '+')) != NULL) {
+        s = p + 1;
+    }
+    if ((p = strchr(s, '$')) != NULL) {
+        *p = 0;
+    }
+    if (!*s || strchr(s, '.')) {
+        return qfalse;
+    }
+
+    return Q_concat(buffer, size, "maps/", s, ".bsp", NULL) < size;
+}
 
 /*
 ================
@@ -141,6 +195,7 @@ void SV_SpawnServer(mapcmd_t *cmd)
     int         i;
     client_t    *client;
     char        *entitystring;
+    char        name[MAX_QPATH];
 
     SCR_BeginLoadingPlaque();           // for local system
 
@@ -253,6 +308,13 @@ void SV_SpawnServer(mapcmd_t *cmd)
     Cvar_Set("sv_paused", "0");
     Cvar_Set("timedemo", "0");
 
+    // start loading the likely next map while this one is played, scripts
+    // run by sv_changemapcmd may override the guess with "preloadmap"
+    if (cmd->state == ss_game && sv_preload_nextmap->integer &&
+        guess_next_map(entitystring, name, sizeof(name))) {
+        BSP_Preload(name);
+    }
+
     EXEC_TRIGGER(sv_changemapcmd);
 
 #if USE_SYSCON
@@ -0,0 +1,545 @@
+/*
+Copyright (C) 2003-2008 Andrey Nazarov
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+//
+// loadgen.c -- synthetic clients for server benchmarking
+//
+
+#include "server.h"
+
+/*
+==============================================================================
+
+LOAD GENERATOR
+
+Synthetic clients are remote players that live inside the server process.
+Each one gets a private 127.128.0.0/16 address and goes through the same
+entry point as a real client packet: connectionless getchallenge and connect
+requests, then old style netchan packets carrying string commands and
+clc_move, all fed to SV_PacketEvent once per server frame.
+
+Server replies are sent through the real UDP socket and discarded by the
+network stack. Acknowledgements are derived from the server side netchan
+state, so reliable data is never retransmitted.
+
+==============================================================================
+*/
+
+#define LG_SAMPLES      1024    // frame times kept for percentiles
+#define LG_RETRY        10      // frames to wait after failed connect
+#define LG_PORT         9       // discard, nothing should listen there
+
+typedef enum {
+    LG_CHALLENGE,
+    LG_CONNECT,
+    LG_ACTIVE
+} lgstate_t;
+
+typedef enum {
+    LG_MODE_IDLE,
+    LG_MODE_RANDOM,
+    LG_MODE_CIRCLE
+} lgmode_t;
+
+typedef struct {
+    lgstate_t   state;
+    netadr_t    address;
+    int         slot;           // server client slot once connected
+    int         qport;
+    int         sequence;       // outgoing netchan sequence
+    unsigned    reliable;       // expected server reliable sequence bit
+    qboolean    pending;        // server had reliable data in flight
+    int         retry;
+    int         framenum;       // last server frame accounted for
+    unsigned    seed;
+    usercmd_t   cmds[3];
+} lgclient_t;
+
+static const char *const lg_modes[] = { "idle", "random", "circle", NULL };
+
+static struct {
+    lgclient_t  *clients;
+    int         numclients;
+    lgmode_t    mode;
+    int         protocol;
+
+    unsigned    frames;
+    unsigned    samples[LG_SAMPLES];
+    uint64_t    phases[SVP_NUM_PHASES];
+    uint64_t    bytes;
+    unsigned    client_frames;
+    unsigned    suppressed;
+} lg;
+
+static unsigned lg_rand(lgclient_t *c)
+{
+    c->seed = c->seed * 1103515245 + 12345;
+    return c->seed >> 16;
+}
+
+// validates cached slot against current client pool
+static client_t *lg_find_client(lgclient_t *c)
+{
+    client_t *cl;
+
+    if (!svs.client_pool || c->slot < 0 || c->slot >= sv_maxclients->integer)
+        return NULL;
+
+    cl = &svs.client_pool[c->slot];
+    if (cl->state <= cs_zombie)
+        return NULL;
+
+    if (!NET_IsEqualAdr(&cl->netchan->remote_address, &c->address))
+        return NULL;
+
+    return cl;
+}
+
+// hands msg_write to the server as if received from the client
+static void lg_deliver(lgclient_t *c)
+{
+    memcpy(msg_read_buffer, msg_write.data, msg_write.cursize);
+    SZ_Init(&msg_read, msg_read_buffer, MAX_MSGLEN);
+    msg_read.cursize = msg_write.cursize;
+    SZ_Clear(&msg_write);
+
+    net_from = c->address;
+    SV_PROF_START(SVP_PACKETS);
+    SV_PacketEvent();
+    SV_PROF_STOP(SVP_PACKETS);
+}
+
+static void lg_send_oob(lgclient_t *c, const char *fmt, ...)
+{
+    char string[MAX_PACKETLEN_DEFAULT];
+    va_list argptr;
+
+    va_start(argptr, fmt);
+    Q_vsnprintf(string, sizeof(string), fmt, argptr);
+    va_end(argptr);
+
+    MSG_WriteLong(-1);
+    MSG_WriteData(string, strlen(string));
+    lg_deliver(c);
+}
+
+static unsigned lg_find_challenge(lgclient_t *c)
+{
+    int i;
+
+    for (i = 0; i < MAX_CHALLENGES; i++) {
+        if (NET_IsEqualBaseAdr(&c->address, &svs.challenges[i].adr))
+            return svs.challenges[i].challenge;
+    }
+
+    return 0;
+}
+
+static void lg_connect(lgclient_t *c)
+{
+    client_t *cl;
+    unsigned challenge;
+
+    challenge = lg_find_challenge(c);
+    if (!challenge) {
+        c->state = LG_CHALLENGE;
+        return;
+    }
+
+    lg_send_oob(c, "connect %d %d %u \"\\name\\loadgen%03d\\skin\\male/grunt"
+                "\\rate\\25000\\msg\\1\\hand\\2\" %d %d %d %d\n",
+                lg.protocol, c->qport, challenge, (int)(c - lg.clients),
+                MAX_PACKETLEN_WRITABLE_DEFAULT, NETCHAN_OLD, 1,
+                PROTOCOL_VERSION_Q2PRO_CURRENT);
+
+    FOR_EACH_CLIENT(cl) {
+        if (NET_IsEqualAdr(&cl->netchan->remote_address, &c->address))
+            break;
+    }
+
+    if (LIST_TERM(cl, &sv_clientlist, entry)) {
+        // rejected, try again later
+        c->state = LG_CHALLENGE;
+        c->retry = LG_RETRY;
+        return;
+    }
+
+    c->state = LG_ACTIVE;
+    c->slot = cl->number;
+    c->sequence = 0;
+    c->reliable = 0;
+    c->pending = qfalse;
+    c->framenum = cl->framenum;
+    memset(c->cmds, 0, sizeof(c->cmds));
+}
+
+static void lg_write_header(lgclient_t *c, client_t *cl)
+{
+    netchan_t *nc = cl->netchan;
+
+    // if server has started a new reliable message since our last packet,
+    // it toggled the reliable sequence bit
+    if (!c->pending && nc->reliable_length)
+        c->reliable ^= 1;
+
+    MSG_WriteLong(++c->sequence);
+    MSG_WriteLong((nc->outgoing_sequence - 1) | (c->reliable << 31));
+    if (cl->protocol == PROTOCOL_VERSION_DEFAULT)
+        MSG_WriteShort(c->qport);
+    else if (nc->qport)
+        MSG_WriteByte(c->qport);
+}
+
+static void lg_write_move(lgclient_t *c, client_t *cl)
+{
+    usercmd_t *cmd;
+
+    c->cmds[0] = c->cmds[1];
+    c->cmds[1] = c->cmds[2];
+
+    cmd = &c->cmds[2];
+    cmd->msec = SV_FRAMETIME;
+    cmd->lightlevel = 128;
+    cmd->impulse = 0;
+
+    switch (lg.mode) {
+    case LG_MODE_RANDOM:
+        // change direction about once a second
+        if (!(lg_rand(c) % 10)) {
+            cmd->angles[YAW] = lg_rand(c);
+            cmd->angles[PITCH] = ANGLE2SHORT((int)(lg_rand(c) % 60) - 30);
+            cmd->forwardmove = ((int)(lg_rand(c) % 3) - 1) * 400;
+            cmd->sidemove = ((int)(lg_rand(c) % 3) - 1) * 400;
+        }
+        cmd->upmove = (lg_rand(c) % 8) ? 0 : 400;
+        cmd->buttons = (lg_rand(c) % 4) ? 0 : BUTTON_ATTACK;
+        break;
+    case LG_MODE_CIRCLE:
+        cmd->angles[YAW] += ANGLE2SHORT(15);
+        cmd->forwardmove = 400;
+        cmd->sidemove = 200;
+        cmd->upmove = 0;
+        cmd->buttons = (sv.framenum & 15) ? 0 : BUTTON_ATTACK;
+        break;
+    default:
+        memset(cmd, 0, sizeof(*cmd));
+        cmd->msec = SV_FRAMETIME;
+        break;
+    }
+
+    MSG_WriteByte(clc_move);
+    if (cl->protocol == PROTOCOL_VERSION_DEFAULT)
+        MSG_WriteByte(0);   // checksum is not verified
+    MSG_WriteLong(cl->framenum - 1);
+    MSG_WriteDeltaUsercmd(NULL, &c->cmds[0], 0);
+    MSG_WriteByte(c->cmds[0].lightlevel);
+    MSG_WriteDeltaUsercmd(&c->cmds[0], &c->cmds[1], 0);
+    MSG_WriteByte(c->cmds[1].lightlevel);
+    MSG_WriteDeltaUsercmd(&c->cmds[1], &c->cmds[2], 0);
+    MSG_WriteByte(c->cmds[2].lightlevel);
+}
+
+static void lg_run_client(lgclient_t *c)
+{
+    client_t *cl;
+
+    if (c->retry > 0) {
+        c->retry--;
+        return;
+    }
+
+    switch (c->state) {
+    case LG_CHALLENGE:
+        lg_send_oob(c, "getchallenge\n");
+        c->state = LG_CONNECT;
+        break;
+    case LG_CONNECT:
+        lg_connect(c);
+        break;
+    case LG_ACTIVE:
+        cl = lg_find_client(c);
+        if (!cl) {
+            // dropped or server restarted
+            c->state = LG_CHALLENGE;
+            break;
+        }
+
+        lg_write_header(c, cl);
+
+        // (re)enter the game after connect or map change
+        if (cl->state < cs_primed) {
+            MSG_WriteByte(clc_stringcmd);
+            MSG_WriteString("new");
+            MSG_WriteByte(clc_stringcmd);
+            MSG_WriteString("\177c version q2pro loadgen");
+            MSG_WriteByte(clc_stringcmd);
+            MSG_WriteString(va("begin %d", sv.spawncount));
+        } else if (cl->state == cs_spawned) {
+            lg_write_move(c, cl);
+        }
+
+        lg_deliver(c);
+
+        cl = lg_find_client(c);
+        if (cl)
+            c->pending = cl->netchan->reliable_length != 0;
+        break;
+    }
+}
+
+/*
+==================
+SV_LoadgenRun
+
+Feeds one packet from each synthetic client.
+==================
+*/
+void SV_LoadgenRun(void)
+{
+    int i;
+
+    for (i = 0; i < lg.numclients; i++)
+        lg_run_client(&lg.clients[i]);
+}
+
+/*
+==================
+SV_LoadgenEndFrame
+
+Accumulates phase timings and bytes sent to synthetic clients.
+Must be called before SV_ProfEndFrame clears the frame totals.
+==================
+*/
+void SV_LoadgenEndFrame(void)
+{
+    lgclient_t *c;
+    client_t *cl;
+    size_t size;
+    int i;
+
+    if (!lg.numclients)
+        return;
+
+    lg.samples[lg.frames % LG_SAMPLES] =
+        sv_prof_time[SVP_FRAME] + sv_prof_time[SVP_PACKETS];
+    lg.frames++;
+
+    for (i = 0; i < SVP_NUM_PHASES; i++)
+        lg.phases[i] += sv_prof_time[i];
+
+    for (i = 0, c = lg.clients; i < lg.numclients; i++, c++) {
+        if (c->state != LG_ACTIVE)
+            continue;
+        cl = lg_find_client(c);
+        if (!cl || cl->state != cs_spawned)
+            continue;
+        if (cl->framenum == c->framenum)
+            continue;   // not sent this frame
+
+        c->framenum = cl->framenum;
+        size = cl->message_size[(cl->framenum - 1) % RATE_MESSAGES];
+        if (size) {
+            lg.bytes += size;
+            lg.client_frames++;
+        } else {
+            lg.suppressed++;    // rate dropped
+        }
+    }
+}
+
+static void lg_reset_stats(void)
+{
+    lg.frames = 0;
+    memset(lg.phases, 0, sizeof(lg.phases));
+    lg.bytes = 0;
+    lg.client_frames = 0;
+    lg.suppressed = 0;
+}
+
+static int lg_sample_cmp(const void *p1, const void *p2)
+{
+    unsigned a = *(const unsigned *)p1;
+    unsigned b = *(const unsigned *)p2;
+
+    return a < b ? -1 : a > b;
+}
+
+static void lg_print_stats(void)
+{
+    unsigned sorted[LG_SAMPLES];
+    client_t *cl;
+    int i, n, spawned;
+
+    if (!lg.frames) {
+        Com_Printf("No frames recorded.\n");
+        return;
+    }
+
+    spawned = 0;
+    for (i = 0; i < lg.numclients; i++) {
+        cl = lg_find_client(&lg.clients[i]);
+        if (cl && cl->state == cs_spawned)
+            spawned++;
+    }
+
+    n = min(lg.frames, LG_SAMPLES);
+    memcpy(sorted, lg.samples, n * sizeof(sorted[0]));
+    qsort(sorted, n, sizeof(sorted[0]), lg_sample_cmp);
+
+    Com_Printf("%d synthetic clients (%d spawned), %u frames\n",
+               lg.numclients, spawned, lg.frames);
+    Com_Printf("frame usec: p50 %u, p90 %u, p99 %u, max %u (last %d frames)\n",
+               sorted[n / 2], sorted[n * 9 / 10], sorted[n * 99 / 100],
+               sorted[n - 1], n);
+
+    Com_Printf("avg usec per frame:");
+    for (i = 0; i < SVP_NUM_PHASES; i++)
+        Com_Printf(" %s %u", sv_prof_names[i], (unsigned)(lg.phases[i] / lg.frames));
+    Com_Printf("\n");
+
+    if (lg.client_frames) {
+        Com_Printf("bytes per client frame: %u (%u client frames, %u rate dropped)\n",
+                   (unsigned)(lg.bytes / lg.client_frames),
+                   lg.client_frames, lg.suppressed);
+    }
+}
+
+static void lg_stop(void)
+{
+    client_t *cl;
+    int i;
+
+    for (i = 0; i < lg.numclients; i++) {
+        cl = lg_find_client(&lg.clients[i]);
+        if (cl) {
+            SV_DropClient(cl, "load generator stopped");
+            SV_RemoveClient(cl);
+        }
+    }
+
+    Z_Free(lg.clients);
+    lg.clients = NULL;
+    lg.numclients = 0;
+    SV_ProfHold(qfalse);
+}
+
+/*
+==================
+SV_LoadgenShutdown
+
+Forgets synthetic clients, the server drops them anyway.
+==================
+*/
+void SV_LoadgenShutdown(void)
+{
+    Z_Free(lg.clients);
+    lg.clients = NULL;
+    lg.numclients = 0;
+    SV_ProfHold(qfalse);
+}
+
+/*
+==================
+SV_Loadgen_f
+
+loadgen <count> [idle|random|circle] [protocol]
+==================
+*/
+void SV_Loadgen_f(void)
+{
+    lgclient_t *c;
+    int i, count, mode, protocol;
+
+    if (Cmd_Argc() < 2) {
+        Com_Printf("Usage: %s <count> [idle|random|circle] [34|36]\n", Cmd_Argv(0));
+        return;
+    }
+
+    if (!svs.initialized) {
+        Com_Printf("No server running.\n");
+        return;
+    }
+
+    count = atoi(Cmd_Argv(1));
+    clamp(count, 1, sv_maxclients->integer);
+
+    mode = LG_MODE_RANDOM;
+    if (Cmd_Argc() > 2) {
+        for (mode = 0; lg_modes[mode]; mode++)
+            if (!strcmp(lg_modes[mode], Cmd_Argv(2)))
+                break;
+        if (!lg_modes[mode]) {
+            Com_Printf("Unknown mode: %s\n", Cmd_Argv(2));
+            return;
+        }
+    }
+
+    protocol = PROTOCOL_VERSION_DEFAULT;
+    if (Cmd_Argc() > 3) {
+        protocol = atoi(Cmd_Argv(3));
+        if (protocol != PROTOCOL_VERSION_DEFAULT &&
+            protocol != PROTOCOL_VERSION_Q2PRO) {
+            Com_Printf("Unsupported protocol: %d\n", protocol);
+            return;
+        }
+    }
+
+    if (lg.numclients)
+        lg_stop();
+
+    lg.clients = SV_Mallocz(sizeof(lg.clients[0]) * count);
+    lg.numclients = count;
+    lg.mode = mode;
+    lg.protocol = protocol;
+    SV_ProfHold(qtrue);
+    lg_reset_stats();
+
+    for (i = 0, c = lg.clients; i < count; i++, c++) {
+        c->address.type = NA_IP;
+        c->address.ip.u8[0] = 127;
+        c->address.ip.u8[1] = 128;
+        c->address.ip.u8[2] = (i + 1) >> 8;
+        c->address.ip.u8[3] = (i + 1) & 255;
+        c->address.port = BigShort(LG_PORT);
+        c->qport = (i & 255) + 1;
+        c->slot = -1;
+        c->seed = i + 1;
+    }
+
+    Com_Printf("Starting %d synthetic clients (%s, protocol %d).\n",
+               count, lg_modes[mode], protocol);
+}
+
+void SV_LoadgenStop_f(void)
+{
+    if (!lg.numclients) {
+        Com_Printf("Load generator is not running.\n");
+        return;
+    }
+
+    lg_print_stats();
+    lg_stop();
+}
+
+void SV_LoadgenStats_f(void)
+{
+    lg_print_stats();
+
+    if (!strcmp(Cmd_Argv(1), "reset"))
+        lg_reset_stats();
+}
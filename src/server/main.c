@@ -58,6 +58,7 @@ cvar_t  *sv_reserved_slots;
 cvar_t  *sv_showclamp;
 cvar_t  *sv_locked;
 cvar_t  *sv_downloadserver;
+cvar_t  *sv_download_cache;
 cvar_t  *sv_redirect_address;
 
 cvar_t  *sv_hostname;
@@ -95,6 +96,7 @@ cvar_t  *sv_allow_unconnected_cmds;
 cvar_t  *g_features;
 
 cvar_t  *map_override_path;
+cvar_t  *sv_preload_nextmap;
 
 qboolean sv_registered;
 
@@ -1412,7 +1414,7 @@ static void SV_GiveMsec(void)
 SV_PacketEvent
 =================
 */
-static void SV_PacketEvent(void)
+void SV_PacketEvent(void)
 {
     client_t    *client;
     netchan_t   *netchan;
@@ -1697,7 +1699,9 @@ SV_RunGameFrame
 static void SV_RunGameFrame(void)
 {
     // save the entire world state if recording a serverdemo
+    SV_PROF_START(SVP_MVD);
     SV_MvdBeginFrame();
+    SV_PROF_STOP(SVP_MVD);
 
 #if USE_CLIENT
     if (host_speeds->integer)
@@ -1707,7 +1711,9 @@ static void SV_RunGameFrame(void)
     X86_PUSH_FPCW;
     X86_SINGLE_FPCW;
 
+    SV_PROF_START(SVP_GAME);
     ge->RunFrame();
+    SV_PROF_STOP(SVP_GAME);
 
     X86_POP_FPCW;
 
@@ -1724,7 +1730,9 @@ static void SV_RunGameFrame(void)
     }
 
     // save the entire world state if recording a serverdemo
+    SV_PROF_START(SVP_MVD);
     SV_MvdEndFrame();
+    SV_PROF_STOP(SVP_MVD);
 }
 
 /*
@@ -1831,7 +1839,9 @@ unsigned SV_Frame(unsigned msec)
 #endif
 
     // read packets from UDP clients
+    SV_PROF_START(SVP_PACKETS);
     NET_GetPackets(NS_SERVER, SV_PacketEvent);
+    SV_PROF_STOP(SVP_PACKETS);
 
     if (svs.initialized) {
         // run connection to the anticheat server
@@ -1851,8 +1861,17 @@ unsigned SV_Frame(unsigned msec)
     }
 
     if (svs.initialized && !check_paused()) {
+#if USE_TESTS
+        // feed packets from synthetic clients
+        SV_LoadgenRun();
+#endif
+
+        SV_PROF_START(SVP_FRAME);
+
         // check timeouts
+        SV_PROF_START(SVP_TIMEOUTS);
         SV_CheckTimeouts();
+        SV_PROF_STOP(SVP_TIMEOUTS);
 
         // update ping based on the last known frame from all clients
         SV_CalcPings();
@@ -1864,7 +1883,9 @@ unsigned SV_Frame(unsigned msec)
         SV_RunGameFrame();
 
         // send messages back to the UDP clients
+        SV_PROF_START(SVP_SEND);
         SV_SendClientMessages();
+        SV_PROF_STOP(SVP_SEND);
 
         // send a heartbeat to the master if needed
         SV_MasterHeartbeat();
@@ -1872,6 +1893,15 @@ unsigned SV_Frame(unsigned msec)
         // clear teleport flags, etc for next frame
         SV_PrepWorldFrame();
 
+        SV_PROF_STOP(SVP_FRAME);
+
+#if USE_TESTS
+        SV_LoadgenEndFrame();
+#endif
+
+        // bin phase timings
+        SV_ProfEndFrame();
+
         // advance for next frame
         sv.framenum++;
     }
@@ -2051,6 +2081,8 @@ void SV_Init(void)
 
     SV_MvdRegister();
 
+    SV_ProfRegister();
+
 #if USE_MVD_CLIENT
     MVD_Register();
 #endif
@@ -2096,6 +2128,7 @@ void SV_Init(void)
     sv_locked = Cvar_Get("sv_locked", "0", 0);
     sv_novis = Cvar_Get("sv_novis", "0", 0);
     sv_downloadserver = Cvar_Get("sv_downloadserver", "", 0);
+    sv_download_cache = Cvar_Get("sv_download_cache", "32768", 0);
     sv_redirect_address = Cvar_Get("sv_redirect_address", "", 0);
 
 #ifdef _DEBUG
@@ -2145,6 +2178,7 @@ void SV_Init(void)
     g_features = Cvar_Get("g_features", "0", CVAR_ROM);
 
     map_override_path = Cvar_Get("map_override_path", "", 0);
+    sv_preload_nextmap = Cvar_Get("sv_preload_nextmap", "1", 0);
 
     init_rate_limits();
 
@@ -2249,6 +2283,12 @@ void SV_Shutdown(const char *finalmsg, error_type_t type)
 
     SV_MvdShutdown(type);
 
+#if USE_TESTS
+    SV_LoadgenShutdown();
+#endif
+
+    SV_ProfShutdown();
+
     SV_FinalMessage(finalmsg, type);
     SV_MasterShutdown();
     SV_ShutdownGameProgs();
@@ -2258,9 +2298,13 @@ void SV_Shutdown(const char *finalmsg, error_type_t type)
     SV_FreeFile(sv.entitystring);
     memset(&sv, 0, sizeof(sv));
 
+    // drop the guessed next map
+    BSP_Preload(NULL);
+
     // free server static data
     Z_Free(svs.client_pool);
     Z_Free(svs.entities);
+    SV_FlushDownloadCache();
 #if USE_ZLIB
     deflateEnd(&svs.z);
 #endif
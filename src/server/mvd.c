@@ -711,7 +711,8 @@ as well as local recorder.
 static void emit_frame(void)
 {
     player_packed_t *oldps, newps;
-    entity_packed_t *oldes, newes;
+    entity_packed_t *oldes;
+    const entity_packed_t *newes;
     edict_t *ent;
     int flags, portalbytes;
     byte portalbits[MAX_MAP_PORTAL_BYTES];
@@ -803,13 +804,19 @@ static void emit_frame(void)
             flags |= MSG_ES_FORCE | MSG_ES_NEWENTITY;
         }
 
-        // quantize
-        MSG_PackEntity(&newes, &ent->s, qfalse);
+        // quantize, sharing work with client frames
+        newes = SV_PackedEntity(ent, i, qfalse);
 
-        MSG_WriteDeltaEntity(oldes, &newes, flags);
+        // nothing to send if bit-identical to the previous frame
+        if (oldes->number && !(newes->renderfx & (RF_FRAMELERP | RF_BEAM)) &&
+            !memcmp(oldes, newes, sizeof(*oldes))) {
+            continue;
+        }
+
+        MSG_WriteDeltaEntity(oldes, newes, flags);
 
         // shuffle current state to previous
-        copy_entity_state(oldes, &newes, flags);
+        copy_entity_state(oldes, newes, flags);
         oldes->number = i;
     }
 
@@ -2034,6 +2041,10 @@ void SV_MvdMapChanged(void)
             // write gamestate to demofile
             rec_write();
         }
+
+        // push out the previous level before loading the next one
+        if (mvd.recording)
+            FS_Flush(mvd.recording);
     }
 
     // clear gamestate
@@ -2234,7 +2245,7 @@ void SV_MvdRecord_f(void)
 {
     char buffer[MAX_OSPATH];
     qhandle_t f;
-    unsigned mode = FS_MODE_WRITE;
+    unsigned mode = FS_MODE_WRITE | FS_FLAG_ASYNC;
     int c;
 
     if (sv.state != ss_game) {
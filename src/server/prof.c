@@ -0,0 +1,445 @@
+/*
+Copyright (C) 2003-2008 Andrey Nazarov
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+//
+// prof.c -- server frame phase timers
+//
+
+#include "server.h"
+#include "common/trace.h"
+
+/*
+==============================================================================
+
+FRAME PROFILER
+
+Scoped timers around server frame phases and their hot callees. Time spent
+in each phase is summed over a server frame (SV_Trace is called hundreds of
+times per frame) and the per-frame totals are binned into power of two
+histograms. The breakdown of the slowest frame is kept separately.
+
+Timers cost a single flag test when sv_profile is off. While a trace capture
+is running, each timed call is also recorded as an event. Once the capture
+ends, events are written out a chunk per frame in Chrome trace event format,
+which chrome://tracing and Perfetto can load.
+
+==============================================================================
+*/
+
+#define PROF_BUCKETS    20          // last one holds everything >= 2^18 usec
+#define PROF_EVENTS     0x40000     // trace capture limit
+#define PROF_WRITE      0x2000      // trace events written per frame
+
+typedef struct {
+    uint64_t    total;
+    unsigned    calls;
+    unsigned    max;
+    unsigned    hist[PROF_BUCKETS];
+} profstat_t;
+
+typedef struct {
+    uint32_t    start;      // usec since capture start
+    uint32_t    dur;
+    int         phase;
+    int         framenum;
+} profevent_t;
+
+static struct {
+    unsigned    frames;
+    profstat_t  stats[SVP_NUM_PHASES];
+
+    // slowest frame since reset
+    unsigned    worst;
+    int         worst_framenum;
+    uint64_t    worst_time[SVP_NUM_PHASES];
+
+    qboolean    hold;
+    qboolean    partial;    // timers were started mid-frame
+
+    // trace capture, events are recorded while trace_frames is non-zero
+    // and written out afterwards
+    qhandle_t   trace_file;
+    char        trace_name[MAX_OSPATH];
+    int         trace_frames;
+    uint64_t    trace_base;
+    profevent_t *events;
+    unsigned    numevents;
+    unsigned    numwritten;
+    unsigned    dropped;
+} prof;
+
+const char *const sv_prof_names[SVP_NUM_PHASES] = {
+    "packets", "timeouts", "game", "mvd", "build",
+    "multicast", "trace", "send", "frame"
+};
+
+qboolean    sv_prof_active;
+uint64_t    sv_prof_start[SVP_NUM_PHASES];
+uint64_t    sv_prof_time[SVP_NUM_PHASES];
+unsigned    sv_prof_calls[SVP_NUM_PHASES];
+
+static cvar_t   *sv_profile;
+
+static void prof_update(void)
+{
+    qboolean active = sv_profile->integer || prof.hold || prof.trace_frames;
+
+    // scopes already running have no start time
+    if (active && !sv_prof_active) {
+        memset(sv_prof_start, 0, sizeof(sv_prof_start));
+        prof.partial = qtrue;
+    }
+
+    sv_prof_active = active;
+}
+
+static void sv_profile_changed(cvar_t *self)
+{
+    prof_update();
+}
+
+/*
+==================
+SV_ProfHold
+
+Keeps timers running regardless of sv_profile, for the load generator.
+==================
+*/
+void SV_ProfHold(qboolean hold)
+{
+    prof.hold = hold;
+    prof_update();
+}
+
+/*
+==================
+SV_ProfStop
+
+Called through SV_PROF_STOP only while profiling is active.
+==================
+*/
+void SV_ProfStop(svprof_t phase)
+{
+    uint64_t now = Sys_Microseconds();
+    uint64_t start = sv_prof_start[phase];
+    profevent_t *ev;
+
+    // started before profiling was turned on
+    if (!start)
+        return;
+
+    sv_prof_start[phase] = 0;
+    sv_prof_time[phase] += now - start;
+    sv_prof_calls[phase]++;
+
+    if (!prof.trace_frames)
+        return;
+
+    // zero length events are invisible in the viewer anyway, and these
+    // are mostly idle packet polls
+    if (now == start)
+        return;
+
+    if (prof.numevents == PROF_EVENTS) {
+        prof.dropped++;
+        return;
+    }
+
+    ev = &prof.events[prof.numevents++];
+    ev->start = start - prof.trace_base;
+    ev->dur = now - start;
+    ev->phase = phase;
+    ev->framenum = sv.framenum;
+}
+
+static int prof_bucket(unsigned usec)
+{
+    int b = 0;
+
+    while (usec && b < PROF_BUCKETS - 1) {
+        usec >>= 1;
+        b++;
+    }
+
+    return b;
+}
+
+// upper bound of the bucket containing given fraction of frames
+static unsigned prof_percentile(const profstat_t *s, unsigned frames, float frac)
+{
+    unsigned need = frames * frac, sum = 0;
+    int b;
+
+    for (b = 0; b < PROF_BUCKETS - 1; b++) {
+        sum += s->hist[b];
+        if (sum > need)
+            break;
+    }
+
+    return b ? (1U << b) - 1 : 0;
+}
+
+static void prof_write_header(void)
+{
+    Com_TraceBegin(prof.trace_file, 1, "server");
+    prof.numwritten = 0;
+}
+
+// writes up to count events, closes the file once all are written
+static void prof_write_trace(unsigned count)
+{
+    profevent_t *ev;
+    unsigned end;
+
+    end = min(prof.numevents, prof.numwritten + count);
+    for (ev = &prof.events[prof.numwritten]; prof.numwritten < end; prof.numwritten++, ev++) {
+        Com_TraceEvent(prof.trace_file, sv_prof_names[ev->phase], 1,
+                       ev->start, ev->dur, ev->framenum);
+    }
+
+    if (prof.numwritten < prof.numevents)
+        return;
+
+    if (Com_TraceEnd(prof.trace_file) < 0)
+        Com_EPrintf("Error writing %s\n", prof.trace_name);
+    else
+        Com_Printf("Wrote %u trace events to %s\n", prof.numevents, prof.trace_name);
+
+    if (prof.dropped)
+        Com_WPrintf("%u trace events dropped, capture fewer frames\n", prof.dropped);
+
+    Z_Free(prof.events);
+    prof.events = NULL;
+    prof.trace_file = 0;
+}
+
+/*
+==================
+SV_ProfEndFrame
+
+Bins phase totals of the frame that just finished.
+==================
+*/
+void SV_ProfEndFrame(void)
+{
+    profstat_t *s;
+    unsigned usec;
+    int i;
+
+    // finished capture is written out over several frames
+    if (prof.trace_file && !prof.trace_frames)
+        prof_write_trace(PROF_WRITE);
+
+    if (!sv_prof_active)
+        return;
+
+    // don't bin a frame that was only partially timed
+    if (prof.partial) {
+        prof.partial = qfalse;
+        goto clear;
+    }
+
+    for (i = 0, s = prof.stats; i < SVP_NUM_PHASES; i++, s++) {
+        usec = sv_prof_time[i];
+        s->total += usec;
+        s->calls += sv_prof_calls[i];
+        s->max = max(s->max, usec);
+        s->hist[prof_bucket(usec)]++;
+    }
+
+    usec = sv_prof_time[SVP_FRAME] + sv_prof_time[SVP_PACKETS];
+    if (usec > prof.worst) {
+        prof.worst = usec;
+        prof.worst_framenum = sv.framenum;
+        memcpy(prof.worst_time, sv_prof_time, sizeof(prof.worst_time));
+    }
+
+    prof.frames++;
+
+clear:
+    memset(sv_prof_time, 0, sizeof(sv_prof_time));
+    memset(sv_prof_calls, 0, sizeof(sv_prof_calls));
+
+    if (prof.trace_frames && --prof.trace_frames == 0) {
+        prof_write_header();
+        prof_update();
+    }
+}
+
+static void prof_reset(void)
+{
+    prof.frames = 0;
+    memset(prof.stats, 0, sizeof(prof.stats));
+    prof.worst = 0;
+    prof.worst_framenum = 0;
+    memset(prof.worst_time, 0, sizeof(prof.worst_time));
+}
+
+static void prof_print_hist(const profstat_t *s)
+{
+    unsigned sum = 0;
+    int b;
+
+    for (b = 0; b < PROF_BUCKETS; b++) {
+        if (!s->hist[b])
+            continue;
+        sum += s->hist[b];
+        if (b == PROF_BUCKETS - 1)
+            Com_Printf("  >= %7u", 1U << (b - 1));
+        else
+            Com_Printf("  <= %7u", b ? (1U << b) - 1 : 0);
+        Com_Printf(" usec: %7u  %5.1f%%  %5.1f%%\n", s->hist[b],
+                   s->hist[b] * 100.0f / prof.frames, sum * 100.0f / prof.frames);
+    }
+}
+
+/*
+==================
+SV_ProfStats_f
+
+profstats [reset|<phase>]
+==================
+*/
+static void SV_ProfStats_f(void)
+{
+    profstat_t *s;
+    char *arg = Cmd_Argv(1);
+    int i;
+
+    if (!prof.frames) {
+        Com_Printf("No frames profiled. Set sv_profile to 1 to enable.\n");
+        return;
+    }
+
+    for (i = 0; i < SVP_NUM_PHASES; i++) {
+        if (!strcmp(arg, sv_prof_names[i])) {
+            Com_Printf("%s usec per frame, %u frames:\n", sv_prof_names[i], prof.frames);
+            prof_print_hist(&prof.stats[i]);
+            return;
+        }
+    }
+
+    Com_Printf("%u frames profiled\n"
+               "phase       avg    p50    p90    p99    max  calls\n"
+               "--------- ------ ------ ------ ------ ------ ------\n",
+               prof.frames);
+    for (i = 0, s = prof.stats; i < SVP_NUM_PHASES; i++, s++) {
+        Com_Printf("%-9s %6u %6u %6u %6u %6u %6.1f\n", sv_prof_names[i],
+                   (unsigned)(s->total / prof.frames),
+                   prof_percentile(s, prof.frames, 0.5f),
+                   prof_percentile(s, prof.frames, 0.9f),
+                   prof_percentile(s, prof.frames, 0.99f),
+                   s->max, (float)s->calls / prof.frames);
+    }
+
+    Com_Printf("slowest frame %d: %u usec,", prof.worst_framenum, prof.worst);
+    for (i = 0; i < SVP_NUM_PHASES; i++) {
+        if (prof.worst_time[i])
+            Com_Printf(" %s %u", sv_prof_names[i], (unsigned)prof.worst_time[i]);
+    }
+    Com_Printf("\n");
+
+    if (!strcmp(arg, "reset"))
+        prof_reset();
+}
+
+/*
+==================
+SV_ProfTrace_f
+
+proftrace <filename> [frames]
+==================
+*/
+static void SV_ProfTrace_f(void)
+{
+    qhandle_t f;
+    int frames;
+
+    if (Cmd_Argc() < 2) {
+        Com_Printf("Usage: %s <filename> [frames]\n", Cmd_Argv(0));
+        return;
+    }
+
+    if (prof.trace_file) {
+        Com_Printf("Still %s %s.\n", prof.trace_frames ? "capturing to" : "writing",
+                   prof.trace_name);
+        return;
+    }
+
+    frames = 100;
+    if (Cmd_Argc() > 2) {
+        frames = atoi(Cmd_Argv(2));
+        clamp(frames, 1, 10000);
+    }
+
+    f = FS_EasyOpenFile(prof.trace_name, sizeof(prof.trace_name), FS_MODE_WRITE,
+                        "profile/", Cmd_Argv(1), ".json");
+    if (!f) {
+        return;
+    }
+
+    prof.trace_file = f;
+    prof.trace_frames = frames;
+    prof.trace_base = Sys_Microseconds();
+    prof.events = Z_Malloc(sizeof(prof.events[0]) * PROF_EVENTS);
+    prof.numevents = 0;
+    prof.dropped = 0;
+    prof_update();
+
+    // events recorded before base would underflow
+    memset(sv_prof_start, 0, sizeof(sv_prof_start));
+
+    Com_Printf("Capturing %d frames to %s\n", frames, prof.trace_name);
+}
+
+/*
+==================
+SV_ProfShutdown
+
+Writes out any trace capture still in progress.
+==================
+*/
+void SV_ProfShutdown(void)
+{
+    if (!prof.trace_file)
+        return;
+
+    if (prof.trace_frames) {
+        prof.trace_frames = 0;
+        prof_write_header();
+        prof_update();
+    }
+
+    prof_write_trace(prof.numevents);
+}
+
+static const cmdreg_t c_svprof[] = {
+    { "profstats", SV_ProfStats_f },
+    { "proftrace", SV_ProfTrace_f },
+
+    { NULL }
+};
+
+void SV_ProfRegister(void)
+{
+    sv_profile = Cvar_Get("sv_profile", "0", 0);
+    sv_profile->changed = sv_profile_changed;
+    prof_update();
+
+    Cmd_Register(c_svprof);
+}
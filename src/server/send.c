@@ -265,6 +265,8 @@ void SV_Multicast(vec3_t origin, multicast_t to)
         Com_Error(ERR_DROP, "%s: no map loaded", __func__);
     }
 
+    SV_PROF_START(SVP_MULTICAST);
+
     flags = 0;
 
     switch (to) {
@@ -333,6 +335,8 @@ void SV_Multicast(vec3_t origin, multicast_t to)
 
     // clear the buffer
     SZ_Clear(&msg_write);
+
+    SV_PROF_STOP(SVP_MULTICAST);
 }
 
 static qboolean compress_message(client_t *client, int flags)
@@ -916,7 +920,9 @@ void SV_SendClientMessages(void)
         }
 
         // build the new frame and write it
+        SV_PROF_START(SVP_BUILD);
         SV_BuildClientFrame(client);
+        SV_PROF_STOP(SVP_BUILD);
         client->WriteDatagram(client);
 
 advance:
@@ -964,7 +970,7 @@ static void write_pending_download(client_t *client)
     SZ_WriteByte(buf, client->downloadcmd);
     SZ_WriteShort(buf, chunk);
     SZ_WriteByte(buf, percent);
-    SZ_Write(buf, client->download + client->downloadcount - chunk, chunk);
+    SZ_Write(buf, client->download->data + client->downloadcount - chunk, chunk);
 
     if (client->downloadcount == client->downloadsize) {
         SV_CloseDownload(client);
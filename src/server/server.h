@@ -111,6 +111,11 @@ typedef struct {
 typedef struct {
     int         solid32;
 
+    // entity state quantized once per server frame for each angle
+    // precision, shared by all client frames and MVD
+    entity_packed_t packed[2];
+    int             packedframe[2];     // sv.framenum + 1 when valid
+
 #if USE_FPS
 
 // must be > MAX_FRAMEDIV
@@ -253,6 +258,19 @@ typedef struct {
     unsigned    cost;
 } ratelimit_t;
 
+// downloaded file shared between all clients fetching it
+typedef struct {
+    list_t      entry;
+    int         refcount;
+    qboolean    zlib;       // variant for clients supporting svc_zdownload
+    int         filelen;    // length of source file when it was cached
+    time_t      mtime;      // modification time of source file (or pack)
+    int         cmd;        // svc_(z)download
+    int         size;
+    byte        *data;
+    char        name[1];
+} dlcache_t;
+
 typedef struct client_s {
     list_t          entry;
 
@@ -312,10 +330,10 @@ typedef struct client_s {
     unsigned        send_time, send_delta;          // used to rate drop async packets
 
     // current download
-    byte            *download;      // file being downloaded
+    dlcache_t       *download;      // shared file being downloaded
     int             downloadsize;   // total bytes (can't use EOF because of paks)
     int             downloadcount;  // bytes sent
-    char            *downloadname;  // name of the file
+    char            *downloadname;  // name of the file, points into download
     int             downloadcmd;    // svc_(z)download
     qboolean        downloadpending;
 
@@ -529,6 +547,9 @@ extern cvar_t       *sv_allow_unconnected_cmds;
 extern cvar_t       *g_features;
 
 extern cvar_t       *map_override_path;
+extern cvar_t       *sv_preload_nextmap;
+
+extern cvar_t       *sv_download_cache;
 
 extern cvar_t       *sv_timeout;
 extern cvar_t       *sv_zombietime;
@@ -549,6 +570,8 @@ void SV_CleanClient(client_t *client);
 
 void SV_InitOperatorCommands(void);
 
+void SV_PacketEvent(void);
+
 void SV_UserinfoChanged(client_t *cl);
 
 qboolean SV_RateLimited(ratelimit_t *r);
@@ -564,6 +587,54 @@ voidpf SV_zalloc(voidpf opaque, uInt items, uInt size);
 void SV_zfree(voidpf opaque, voidpf address);
 #endif
 
+//
+// prof.c
+//
+typedef enum {
+    SVP_PACKETS,    // packet processing
+    SVP_TIMEOUTS,   // SV_CheckTimeouts
+    SVP_GAME,       // ge->RunFrame
+    SVP_MVD,        // MVD frame begin and end
+    SVP_BUILD,      // SV_BuildClientFrame
+    SVP_MULTICAST,  // SV_Multicast
+    SVP_TRACE,      // SV_Trace
+    SVP_SEND,       // SV_SendClientMessages
+    SVP_FRAME,      // whole server frame, minus packets
+
+    SVP_NUM_PHASES
+} svprof_t;
+
+extern const char *const sv_prof_names[SVP_NUM_PHASES];
+
+extern qboolean     sv_prof_active;
+extern uint64_t     sv_prof_start[SVP_NUM_PHASES];
+extern uint64_t     sv_prof_time[SVP_NUM_PHASES];
+extern unsigned     sv_prof_calls[SVP_NUM_PHASES];
+
+// phases must not nest within themselves
+#define SV_PROF_START(p) \
+    (sv_prof_active ? (void)(sv_prof_start[p] = Sys_Microseconds()) : (void)0)
+#define SV_PROF_STOP(p) \
+    (sv_prof_active ? SV_ProfStop(p) : (void)0)
+
+void SV_ProfStop(svprof_t phase);
+void SV_ProfEndFrame(void);
+void SV_ProfHold(qboolean hold);
+void SV_ProfShutdown(void);
+void SV_ProfRegister(void);
+
+//
+// loadgen.c
+//
+#if USE_TESTS
+void SV_LoadgenRun(void);
+void SV_LoadgenEndFrame(void);
+void SV_LoadgenShutdown(void);
+void SV_Loadgen_f(void);
+void SV_LoadgenStop_f(void);
+void SV_LoadgenStats_f(void);
+#endif
+
 //
 // sv_init.c
 //
@@ -689,6 +760,7 @@ void SV_New_f(void);
 void SV_Begin_f(void);
 void SV_ExecuteClientMessage(client_t *cl);
 void SV_CloseDownload(client_t *client);
+void SV_FlushDownloadCache(void);
 #if USE_FPS
 void SV_AlignKeyFrames(client_t *client);
 #else
@@ -715,6 +787,7 @@ void SV_PrintMiscInfo(void);
 #define ES_INUSE(s) \
     ((s)->modelindex || (s)->effects || (s)->sound || (s)->event)
 
+const entity_packed_t *SV_PackedEntity(edict_t *ent, int e, qboolean short_angles);
 void SV_BuildProxyClientFrame(client_t *client);
 void SV_BuildClientFrame(client_t *client);
 void SV_WriteFrameToClient_Default(client_t *client);
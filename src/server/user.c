@@ -534,16 +534,156 @@ void SV_Begin_f(void)
 
 //=============================================================================
 
+/*
+============================================================
+
+DOWNLOAD CACHE
+
+Each downloadable file is loaded (and possibly compressed) only once and then
+shared between all clients downloading it. Entries are keyed on source file
+length and modification time, so replaced files are loaded again. Files no
+longer referenced are kept in LRU order until sv_download_cache limit is
+exceeded.
+============================================================
+*/
+
+static LIST_DECL(sv_dlcache);
+static size_t sv_dlcache_size;
+
+static void free_download(dlcache_t *dl)
+{
+    List_Remove(&dl->entry);
+    sv_dlcache_size -= dl->size;
+    Z_Free(dl->data);
+    Z_Free(dl);
+}
+
+static void trim_download_cache(size_t limit)
+{
+    dlcache_t *dl, *next;
+
+    LIST_FOR_EACH_SAFE(dlcache_t, dl, next, &sv_dlcache, entry) {
+        if (sv_dlcache_size <= limit)
+            break;
+        if (!dl->refcount)
+            free_download(dl);
+    }
+}
+
+void SV_FlushDownloadCache(void)
+{
+    trim_download_cache(0);
+}
+
+#if USE_ZLIB
+// compress the whole file into a single raw deflate stream
+static byte *deflate_download(byte *data, int len, int *outlen)
+{
+    byte    *buf;
+    uLong   bound;
+
+    bound = deflateBound(&svs.z, len);
+    buf = SV_Malloc(bound);
+
+    deflateReset(&svs.z);
+    svs.z.next_in = data;
+    svs.z.avail_in = (uInt)len;
+    svs.z.next_out = buf;
+    svs.z.avail_out = (uInt)bound;
+
+    if (deflate(&svs.z, Z_FINISH) != Z_STREAM_END || svs.z.total_out >= len) {
+        Z_Free(buf);
+        return NULL;
+    }
+
+    *outlen = svs.z.total_out;
+    return Z_Realloc(buf, *outlen);
+}
+#endif
+
+static size_t download_cache_limit(void)
+{
+    return (size_t)Cvar_ClampInteger(sv_download_cache, 0, 0x100000) * 1024;
+}
+
+static dlcache_t *acquire_download(const char *name, qhandle_t f,
+                                   int filelen, int cmd, qboolean zlib)
+{
+    dlcache_t   *dl, *next;
+    file_info_t info;
+    byte        *data;
+    int         size;
+    size_t      len;
+
+    if (FS_GetFileInfo(f, &info))
+        info.mtime = 0;
+
+    LIST_FOR_EACH_SAFE(dlcache_t, dl, next, &sv_dlcache, entry) {
+        if (dl->zlib != zlib || FS_pathcmp(dl->name, name))
+            continue;
+        if (dl->filelen == filelen && dl->mtime == info.mtime)
+            goto found;
+        // stale copy of a replaced file
+        if (!dl->refcount)
+            free_download(dl);
+    }
+
+    data = SV_Malloc(filelen);
+    if (FS_Read(data, filelen, f) != filelen) {
+        Z_Free(data);
+        return NULL;
+    }
+    size = filelen;
+
+#if USE_ZLIB
+    // file is not available deflated from .pkz, compress it now
+    if (zlib && cmd == svc_download) {
+        byte *comp = deflate_download(data, filelen, &size);
+
+        if (comp) {
+            Z_Free(data);
+            data = comp;
+            cmd = svc_zdownload;
+        } else {
+            size = filelen;
+        }
+    }
+#endif
+
+    len = strlen(name);
+    dl = SV_Malloc(sizeof(*dl) + len);
+    dl->refcount = 0;
+    dl->zlib = zlib;
+    dl->filelen = filelen;
+    dl->mtime = info.mtime;
+    dl->cmd = cmd;
+    dl->size = size;
+    dl->data = data;
+    memcpy(dl->name, name, len + 1);
+    List_Append(&sv_dlcache, &dl->entry);
+    sv_dlcache_size += size;
+
+    Com_DPrintf("Cached download of %s (%d bytes)\n", name, size);
+
+found:
+    // move to the most recently used end
+    List_Remove(&dl->entry);
+    List_Append(&sv_dlcache, &dl->entry);
+    dl->refcount++;
+
+    // make room for what was just added
+    trim_download_cache(download_cache_limit());
+    return dl;
+}
+
 void SV_CloseDownload(client_t *client)
 {
     if (client->download) {
-        Z_Free(client->download);
+        client->download->refcount--;
         client->download = NULL;
+        trim_download_cache(download_cache_limit());
     }
-    if (client->downloadname) {
-        Z_Free(client->downloadname);
-        client->downloadname = NULL;
-    }
+    client->downloadname = NULL;
     client->downloadsize = 0;
     client->downloadcount = 0;
     client->downloadcmd = 0;
@@ -571,13 +711,14 @@ SV_BeginDownload_f
 static void SV_BeginDownload_f(void)
 {
     char    name[MAX_QPATH];
-    byte    *download;
+    dlcache_t *download;
     int     downloadcmd;
-    ssize_t downloadsize, maxdownloadsize, result;
+    ssize_t downloadsize, maxdownloadsize;
     int     offset = 0;
     cvar_t  *allow;
     size_t  len;
     qhandle_t f;
+    qboolean zlib = qfalse;
 
     len = Cmd_ArgvBuffer(1, name, sizeof(name));
     if (len >= MAX_QPATH) {
@@ -650,6 +791,7 @@ static void SV_BeginDownload_f(void)
     if (sv_client->protocol == PROTOCOL_VERSION_Q2PRO &&
         sv_client->version >= PROTOCOL_VERSION_Q2PRO_ZLIB_DOWNLOADS &&
         sv_client->has_zlib && offset == 0) {
+        zlib = qtrue;
         downloadsize = FS_FOpenFile(name, &f, FS_MODE_READ | FS_FLAG_DEFLATE);
         if (f) {
             Com_DPrintf("Serving compressed download to %s\n", sv_client->name);
@@ -702,27 +844,24 @@ static void SV_BeginDownload_f(void)
         return;
     }
 
-    download = SV_Malloc(downloadsize);
-    result = FS_Read(download, downloadsize, f);
-    if (result != downloadsize) {
+    download = acquire_download(name, f, downloadsize, downloadcmd, zlib);
+    if (!download) {
         Com_DPrintf("Couldn't download %s to %s\n", name, sv_client->name);
-        goto fail3;
+        goto fail2;
     }
 
     FS_FCloseFile(f);
 
     sv_client->download = download;
-    sv_client->downloadsize = downloadsize;
+    sv_client->downloadsize = download->size;
     sv_client->downloadcount = offset;
-    sv_client->downloadname = SV_CopyString(name);
-    sv_client->downloadcmd = downloadcmd;
+    sv_client->downloadname = download->name;
+    sv_client->downloadcmd = download->cmd;
     sv_client->downloadpending = qtrue;
 
     Com_DPrintf("Downloading %s to %s\n", name, sv_client->name);
     return;
 
-fail3:
-    Z_Free(download);
 fail2:
     FS_FCloseFile(f);
 fail1:
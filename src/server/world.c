@@ -552,6 +552,8 @@ trace_t q_gameabi SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end,
         Com_Error(ERR_DROP, "%s: no map loaded", __func__);
     }
 
+    SV_PROF_START(SVP_TRACE);
+
     // work around game bugs
     if (++sv.tracecount > 10000) {
         Com_EPrintf("%s: runaway loop avoided\n", __func__);
@@ -560,6 +562,7 @@ trace_t q_gameabi SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end,
         trace.ent = ge->edicts;
         VectorCopy(end, trace.endpos);
         sv.tracecount = 0;
+        SV_PROF_STOP(SVP_TRACE);
         return trace;
     }
 
@@ -572,11 +575,13 @@ trace_t q_gameabi SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end,
     CM_BoxTrace(&trace, start, end, mins, maxs, sv.cm.cache->nodes, contentmask);
     trace.ent = ge->edicts;
     if (trace.fraction == 0) {
+        SV_PROF_STOP(SVP_TRACE);
         return trace;   // blocked by the world
     }
 
     // clip to other solid entities
     SV_ClipMoveToEntities(start, mins, maxs, end, passedict, contentmask, &trace);
+    SV_PROF_STOP(SVP_TRACE);
     return trace;
 }
 
@@ -37,6 +37,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <dirent.h>
 #include <dlfcn.h>
 #include <errno.h>
+#include <pthread.h>
 
 #if USE_SDL
 #include <SDL_main.h>
@@ -72,6 +73,14 @@ unsigned Sys_Milliseconds(void)
     return time;
 }
 
+uint64_t Sys_Microseconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /*
 =================
 Sys_Quit
@@ -251,6 +260,175 @@ void Sys_Error(const char *error, ...)
 /*
 ========================================================================
 
+THREADS
+
+========================================================================
+*/
+
+typedef struct {
+    pthread_t   thread;
+    void        (*func)(void *);
+    void        *arg;
+} sys_thread_t;
+
+typedef struct {
+    pthread_cond_t  cond;
+    qboolean        signaled;
+} sys_cond_t;
+
+static void *thread_func(void *arg)
+{
+    sys_thread_t *t = arg;
+
+    t->func(t->arg);
+    return NULL;
+}
+
+void *Sys_CreateThread(void (*func)(void *), void *arg)
+{
+    sys_thread_t *t = Z_Malloc(sizeof(*t));
+    int ret;
+
+    t->func = func;
+    t->arg = arg;
+
+    ret = pthread_create(&t->thread, NULL, thread_func, t);
+    if (ret) {
+        Com_SetLastError(strerror(ret));
+        Z_Free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+void Sys_JoinThread(void *thread)
+{
+    sys_thread_t *t = thread;
+
+    pthread_join(t->thread, NULL);
+    Z_Free(t);
+}
+
+void *Sys_CreateMutex(void)
+{
+    pthread_mutex_t *m = Z_Malloc(sizeof(*m));
+
+    pthread_mutex_init(m, NULL);
+    return m;
+}
+
+void Sys_DestroyMutex(void *mutex)
+{
+    pthread_mutex_destroy(mutex);
+    Z_Free(mutex);
+}
+
+void Sys_LockMutex(void *mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+void Sys_UnlockMutex(void *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+void *Sys_CreateCond(void)
+{
+    sys_cond_t *c = Z_Malloc(sizeof(*c));
+
+    pthread_cond_init(&c->cond, NULL);
+    c->signaled = qfalse;
+    return c;
+}
+
+void Sys_DestroyCond(void *cond)
+{
+    sys_cond_t *c = cond;
+
+    pthread_cond_destroy(&c->cond);
+    Z_Free(c);
+}
+
+// must be called with mutex held
+void Sys_WaitCond(void *cond, void *mutex)
+{
+    sys_cond_t *c = cond;
+
+    while (!c->signaled)
+        pthread_cond_wait(&c->cond, mutex);
+    c->signaled = qfalse;
+}
+
+// must be called with mutex held
+void Sys_SignalCond(void *cond)
+{
+    sys_cond_t *c = cond;
+
+    c->signaled = qtrue;
+    pthread_cond_signal(&c->cond);
+}
+
+/*
+========================================================================
+
+FILE MAPPING
+
+========================================================================
+*/
+
+typedef struct {
+    void    *base;
+    size_t  size;
+} sys_map_t;
+
+/*
+================
+Sys_MapFile
+
+Maps len bytes of the file at given offset read-only. Returns NULL if the
+file can't be mapped, caller should read it instead.
+================
+*/
+void *Sys_MapFile(FILE *fp, size_t offset, size_t len, const void **data)
+{
+    sys_map_t *m;
+    size_t pad = offset % sysconf(_SC_PAGESIZE);
+    void *base;
+
+    if (!len)
+        return NULL;
+
+    base = mmap(NULL, len + pad, PROT_READ, MAP_PRIVATE,
+                fileno(fp), (off_t)(offset - pad));
+    if (base == MAP_FAILED)
+        return NULL;
+
+#ifdef MADV_WILLNEED
+    // whole file is about to be read, start paging it in
+    madvise(base, len + pad, MADV_WILLNEED);
+#endif
+
+    m = Z_Malloc(sizeof(*m));
+    m->base = base;
+    m->size = len + pad;
+
+    *data = (byte *)base + pad;
+    return m;
+}
+
+void Sys_UnmapFile(void *map)
+{
+    sys_map_t *m = map;
+
+    munmap(m->base, m->size);
+    Z_Free(m);
+}
+
+/*
+========================================================================
+
 DLL LOADING
 
 ========================================================================
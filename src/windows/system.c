@@ -21,6 +21,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "common/field.h"
 #include "common/prompt.h"
 #include <mmsystem.h>
+#include <io.h>
 #if USE_WINSVC
 #include <winsvc.h>
 #endif
@@ -641,6 +642,19 @@ unsigned Sys_Milliseconds(void)
     return timeGetTime();
 }
 
+uint64_t Sys_Microseconds(void)
+{
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+
+    QueryPerformanceCounter(&count);
+    return count.QuadPart / freq.QuadPart * 1000000 +
+           count.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart;
+}
+
 void Sys_AddDefaultConfig(void)
 {
 }
@@ -739,6 +753,173 @@ void Sys_Init(void)
 /*
 ========================================================================
 
+THREADS
+
+========================================================================
+*/
+
+typedef struct {
+    HANDLE      thread;
+    void        (*func)(void *);
+    void        *arg;
+} sys_thread_t;
+
+static DWORD WINAPI thread_func(LPVOID arg)
+{
+    sys_thread_t *t = arg;
+
+    t->func(t->arg);
+    return 0;
+}
+
+void *Sys_CreateThread(void (*func)(void *), void *arg)
+{
+    sys_thread_t *t = Z_Malloc(sizeof(*t));
+
+    t->func = func;
+    t->arg = arg;
+
+    t->thread = CreateThread(NULL, 0, thread_func, t, 0, NULL);
+    if (!t->thread) {
+        Com_SetLastError(va("CreateThread failed with error %lu", GetLastError()));
+        Z_Free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+void Sys_JoinThread(void *thread)
+{
+    sys_thread_t *t = thread;
+
+    WaitForSingleObject(t->thread, INFINITE);
+    CloseHandle(t->thread);
+    Z_Free(t);
+}
+
+void *Sys_CreateMutex(void)
+{
+    CRITICAL_SECTION *cs = Z_Malloc(sizeof(*cs));
+
+    InitializeCriticalSection(cs);
+    return cs;
+}
+
+void Sys_DestroyMutex(void *mutex)
+{
+    DeleteCriticalSection(mutex);
+    Z_Free(mutex);
+}
+
+void Sys_LockMutex(void *mutex)
+{
+    EnterCriticalSection(mutex);
+}
+
+void Sys_UnlockMutex(void *mutex)
+{
+    LeaveCriticalSection(mutex);
+}
+
+// auto-reset event is enough for a single waiter
+void *Sys_CreateCond(void)
+{
+    return CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+void Sys_DestroyCond(void *cond)
+{
+    CloseHandle(cond);
+}
+
+// must be called with mutex held
+void Sys_WaitCond(void *cond, void *mutex)
+{
+    LeaveCriticalSection(mutex);
+    WaitForSingleObject(cond, INFINITE);
+    EnterCriticalSection(mutex);
+}
+
+// must be called with mutex held
+void Sys_SignalCond(void *cond)
+{
+    SetEvent(cond);
+}
+
+/*
+========================================================================
+
+FILE MAPPING
+
+========================================================================
+*/
+
+typedef struct {
+    HANDLE      mapping;
+    void        *base;
+} sys_map_t;
+
+/*
+================
+Sys_MapFile
+
+Maps len bytes of the file at given offset read-only. Returns NULL if the
+file can't be mapped, caller should read it instead.
+================
+*/
+void *Sys_MapFile(FILE *fp, size_t offset, size_t len, const void **data)
+{
+    sys_map_t *m;
+    SYSTEM_INFO si;
+    HANDLE handle, mapping;
+    uint64_t start;
+    size_t pad;
+    void *base;
+
+    if (!len)
+        return NULL;
+
+    handle = (HANDLE)_get_osfhandle(_fileno(fp));
+    if (handle == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    // views must start at allocation granularity boundary
+    GetSystemInfo(&si);
+    pad = offset % si.dwAllocationGranularity;
+    start = offset - pad;
+
+    mapping = CreateFileMapping(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+        return NULL;
+
+    base = MapViewOfFile(mapping, FILE_MAP_READ,
+                         (DWORD)(start >> 32), (DWORD)start, len + pad);
+    if (!base) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+
+    m = Z_Malloc(sizeof(*m));
+    m->mapping = mapping;
+    m->base = base;
+
+    *data = (byte *)base + pad;
+    return m;
+}
+
+void Sys_UnmapFile(void *map)
+{
+    sys_map_t *m = map;
+
+    UnmapViewOfFile(m->base);
+    CloseHandle(m->mapping);
+    Z_Free(m);
+}
+
+/*
+========================================================================
+
 DLL LOADING
 
 ========================================================================